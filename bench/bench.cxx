@@ -0,0 +1,408 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "bdp.hxx"
+#include "builder.hxx"
+#include "context.hxx"
+#include "map.hxx"
+#include "stream.hxx"
+#include "transcode.hxx"
+#include "view.hxx"
+#include "writer.hxx"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Measures write, read, map building and transcode throughput for every package type, pair size distribution and I/O overload.
+ *
+ * Usage: bdp_bench [--bytes N] [--type BDP832] [--output results.jsonl]
+ *
+ * Every result is printed as one JSON object per line.
+ */
+
+/// The default amount of pair data processed per benchmark case.
+const size_t DEFAULT_CASE_BYTES = 16u * 1024u * 1024u;
+/// The size of the buffer passed to the stream-to-stream overloads.
+const size_t BENCH_BUFFER_SIZE = 16384u;
+
+const uint8_t BIT_SIZES[] = { 8u, 16u, 32u, 64u };
+
+struct Distribution {
+    const char* name;
+    size_t nameLength;
+    size_t valueLength;
+};
+
+const Distribution DISTRIBUTIONS[] = {
+    { "tiny",   8u,  8u },
+    { "small",  16u, 64u },
+    { "medium", 32u, 4096u },
+    { "large",  32u, 1048576u },
+    { "huge",   32u, 8388608u }
+};
+
+struct Result {
+    std::string type;
+    std::string distribution;
+    std::string operation;
+    size_t pairs;
+    size_t bytes;
+    double seconds;
+};
+
+struct Options {
+    size_t caseBytes = DEFAULT_CASE_BYTES;
+    std::string type;
+    std::string output;
+};
+
+double measure(const std::function<void()>& function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+void printResult(std::ostream& output, const Result& result) {
+    double megabytes = static_cast<double>(result.bytes) / (1024.0 * 1024.0);
+    double seconds = result.seconds > 0.0 ? result.seconds : 1e-9;
+
+    output << "{\"type\":\"" << result.type
+           << "\",\"distribution\":\"" << result.distribution
+           << "\",\"operation\":\"" << result.operation
+           << "\",\"pairs\":" << result.pairs
+           << ",\"bytes\":" << result.bytes
+           << ",\"seconds\":" << result.seconds
+           << ",\"mb_per_second\":" << megabytes / seconds
+           << ",\"pairs_per_second\":" << static_cast<double>(result.pairs) / seconds
+           << "}\n";
+}
+
+// Runs every operation for one package type and distribution.
+void runCase(uint8_t nameBits, uint8_t valueBits, const Distribution& distribution, const Options& options, std::vector<Result>& results) {
+    std::string type = "BDP" + std::to_string(nameBits) + std::to_string(valueBits);
+
+    std::string name(distribution.nameLength, 'n');
+    std::string value(distribution.valueLength, 'v');
+
+    for(size_t i = 0u; i < value.size(); ++i)
+        value[i] = static_cast<char>(i * 31u);
+
+    const uint8_t* nameBytes = reinterpret_cast<const uint8_t*>(name.data());
+    const uint8_t* valueBytes = reinterpret_cast<const uint8_t*>(value.data());
+
+    size_t pairs = options.caseBytes / (name.size() + value.size());
+    if(pairs == 0u)
+        pairs = 1u;
+
+    uint8_t headerBytes[BDP::HEADER_LENGTH];
+    std::unique_ptr<BDP::Header> header(BDP::writeHeader(headerBytes, nameBits, valueBits));
+    size_t pairLength = header->NAME_LENGTH_BYTE_SIZE + name.size() + header->VALUE_LENGTH_BYTE_SIZE + value.size();
+    size_t payload = pairs * (name.size() + value.size());
+
+    auto add = [&](const char* operation, double seconds) {
+        results.push_back({ type, distribution.name, operation, pairs, payload, seconds });
+        printResult(std::cout, results.back());
+    };
+
+    // Writing.
+    std::ostringstream streamPackage;
+
+    add("write_stream", measure([&]() {
+        for(size_t i = 0u; i < pairs; ++i)
+            BDP::writePair(header.get(), streamPackage, nameBytes, name.size(), valueBytes, value.size());
+    }));
+
+    std::vector<uint8_t> buffer(pairs * pairLength);
+
+    add("write_buffer", measure([&]() {
+        uint8_t* output = buffer.data();
+
+        for(size_t i = 0u; i < pairs; ++i)
+            output += BDP::writePair(header.get(), output, nameBytes, name.size(), valueBytes, value.size());
+    }));
+
+    // The source streams are created once, and only rewound for every pair, so the timing doesn't
+    // include copying the name and the value into them.
+    std::istringstream nameStream(name);
+    std::istringstream valueStream(value);
+    std::ostringstream copiedPackage;
+
+    add("write_stream_to_stream", measure([&]() {
+        for(size_t i = 0u; i < pairs; ++i) {
+            nameStream.clear();
+            nameStream.seekg(0);
+            valueStream.clear();
+            valueStream.seekg(0);
+
+            BDP::writePair(header.get(), copiedPackage, nameStream, valueStream, BENCH_BUFFER_SIZE);
+        }
+    }));
+
+    std::ostringstream contextPackage;
+    BDP::Context context(BENCH_BUFFER_SIZE);
+    context.setHeader(nameBits, valueBits);
+
+    add("write_stream_to_stream_context", measure([&]() {
+        for(size_t i = 0u; i < pairs; ++i) {
+            nameStream.clear();
+            nameStream.seekg(0);
+            valueStream.clear();
+            valueStream.seekg(0);
+
+            context.writePair(contextPackage, nameStream, valueStream);
+        }
+    }));
+
+    std::ostringstream writerPackage;
+
+    add("write_writer", measure([&]() {
+        BDP::PackageWriter writer(writerPackage, nameBits, valueBits);
+
+        for(size_t i = 0u; i < pairs; ++i)
+            writer.writePair(nameBytes, name.size(), valueBytes, value.size());
+    }));
+
+    std::ostringstream builderPackage;
+
+    add("write_builder", measure([&]() {
+        BDP::PackageBuilder builder(nameBits, valueBits);
+
+        size_t threadCount = std::thread::hardware_concurrency();
+        if(threadCount == 0u)
+            threadCount = 1u;
+
+        std::vector<std::thread> threads;
+
+        for(size_t t = 0u; t < threadCount; ++t) {
+            threads.emplace_back([&, t]() {
+                BDP::PackageSegment& segment = builder.createSegment();
+
+                for(size_t i = t; i < pairs; i += threadCount)
+                    segment.writePair(nameBytes, name.size(), valueBytes, value.size());
+            });
+        }
+
+        for(std::thread& thread : threads)
+            thread.join();
+
+        builder.writeTo(builderPackage);
+    }));
+
+    // Reading.
+    std::string package = streamPackage.str();
+    std::vector<uint8_t> nameOutput(name.size());
+    std::vector<uint8_t> valueOutput(value.size());
+    size_t nameLength;
+    size_t valueLength;
+
+    add("read_stream", measure([&]() {
+        std::istringstream input(package);
+
+        for(size_t i = 0u; i < pairs; ++i)
+            BDP::readPair(header.get(), input, nameOutput.data(), &nameLength, valueOutput.data(), &valueLength);
+    }));
+
+    add("read_buffer", measure([&]() {
+        const uint8_t* input = buffer.data();
+
+        for(size_t i = 0u; i < pairs; ++i)
+            input += BDP::readPair(header.get(), input, nameOutput.data(), &nameLength, valueOutput.data(), &valueLength);
+    }));
+
+    std::string viewPackage = writerPackage.str();
+
+    add("read_view", measure([&]() {
+        BDP::PackageView view(reinterpret_cast<const uint8_t*>(viewPackage.data()), viewPackage.size());
+
+        for(const BDP::PairView& pair : view) {
+            nameLength = pair.name.size();
+            valueLength = pair.value.size();
+        }
+    }));
+
+    add("read_stream_iterator", measure([&]() {
+        std::istringstream input(viewPackage);
+        BDP::PackageStream stream(input);
+
+        for(const BDP::StreamPair& pair : stream) {
+            nameLength = pair.name.size();
+            valueLength = pair.valueLength;
+        }
+    }));
+
+    add("read_stream_to_stream", measure([&]() {
+        std::istringstream input(package);
+        std::ostringstream nameStream;
+        std::ostringstream valueStream;
+
+        for(size_t i = 0u; i < pairs; ++i) {
+            nameStream.seekp(0);
+            valueStream.seekp(0);
+
+            BDP::readPair(header.get(), input, nameStream, valueStream, BENCH_BUFFER_SIZE);
+        }
+    }));
+
+    add("read_stream_to_stream_context", measure([&]() {
+        std::istringstream input(package);
+        std::ostringstream nameStream;
+        std::ostringstream valueStream;
+
+        for(size_t i = 0u; i < pairs; ++i) {
+            nameStream.seekp(0);
+            valueStream.seekp(0);
+
+            context.readPair(input, nameStream, valueStream);
+        }
+    }));
+
+    // Map building. The names are made unique, so that every pair gets its own entry.
+    std::ostringstream mapStream;
+
+    {
+        BDP::PackageWriter writer(mapStream, nameBits, valueBits);
+        std::string uniqueName = name;
+
+        for(size_t i = 0u; i < pairs; ++i) {
+            for(size_t j = 0u; j < uniqueName.size() && j < sizeof(size_t); ++j)
+                uniqueName[uniqueName.size() - 1u - j] = static_cast<char>(i >> (j * 8u));
+
+            writer.writePair(reinterpret_cast<const uint8_t*>(uniqueName.data()), uniqueName.size(), valueBytes, value.size());
+        }
+    }
+
+    std::string mapPackage = mapStream.str();
+    const uint8_t* mapBytes = reinterpret_cast<const uint8_t*>(mapPackage.data());
+    size_t mapSize;
+
+    add("map_build", measure([&]() {
+        BDP::PackageMap map(BDP::PackageView(mapBytes, mapPackage.size()));
+        mapSize = map.getSize();
+    }));
+
+    // The baseline for map building: reading every pair, and copying it into a standard map.
+    add("map_build_unordered_map", measure([&]() {
+        std::unordered_map<std::string, std::string> map;
+        map.reserve(pairs);
+
+        const uint8_t* input = mapBytes + BDP::HEADER_LENGTH;
+
+        for(size_t i = 0u; i < pairs; ++i) {
+            input += BDP::readPair(header.get(), input, nameOutput.data(), &nameLength, valueOutput.data(), &valueLength);
+            map.emplace(std::string(reinterpret_cast<const char*>(nameOutput.data()), nameLength),
+                        std::string(reinterpret_cast<const char*>(valueOutput.data()), valueLength));
+        }
+
+        mapSize = map.size();
+    }));
+
+    // Transcoding. Every name fits in 8 bits, so only the name length width changes, and the
+    // package is never transcoded to its own type (which would be a plain copy).
+    const uint8_t* viewBytes = reinterpret_cast<const uint8_t*>(viewPackage.data());
+    uint8_t targetNameBits = nameBits == 8u ? 16u : 8u;
+    std::vector<uint8_t> transcoded(BDP::getTranscodedLength(viewBytes, viewPackage.size(), targetNameBits, valueBits));
+
+    add("transcode", measure([&]() {
+        BDP::transcodePackage(viewBytes, viewPackage.size(), transcoded.data(), transcoded.size(), targetNameBits, valueBits);
+    }));
+
+    // The baseline for transcoding: copying the same package as one block.
+    std::vector<uint8_t> copied(viewPackage.size());
+
+    add("memcpy", measure([&]() {
+        memcpy(copied.data(), viewBytes, viewPackage.size());
+    }));
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for(int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+
+        if(i + 1 >= argc)
+            return false;
+
+        if(argument == "--bytes")
+            options.caseBytes = std::strtoull(argv[++i], nullptr, 10);
+        else if(argument == "--type")
+            options.type = argv[++i];
+        else if(argument == "--output")
+            options.output = argv[++i];
+        else return false;
+    }
+
+    return options.caseBytes != 0u;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+
+    if(!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [--bytes N] [--type BDP832] [--output results.jsonl]\n";
+        return 1;
+    }
+
+    std::vector<Result> results;
+
+    for(uint8_t nameBits : BIT_SIZES) {
+        for(uint8_t valueBits : BIT_SIZES) {
+            if constexpr(sizeof(size_t) < 8)
+                if(nameBits == 64u || valueBits == 64u)
+                    continue;
+
+            std::string type = "BDP" + std::to_string(nameBits) + std::to_string(valueBits);
+
+            if(!options.type.empty() && options.type != type)
+                continue;
+
+            for(const Distribution& distribution : DISTRIBUTIONS) {
+                // Skip the distributions which don't fit in the package type.
+                if(distribution.nameLength > BDP::getMaxLength(nameBits) || distribution.valueLength > BDP::getMaxLength(valueBits))
+                    continue;
+
+                runCase(nameBits, valueBits, distribution, options, results);
+            }
+        }
+    }
+
+    if(!options.output.empty()) {
+        std::ofstream output(options.output, std::ios::trunc);
+
+        for(const Result& result : results)
+            printResult(output, result);
+    }
+
+    return 0;
+}
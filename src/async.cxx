@@ -0,0 +1,688 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "async.hxx"
+#include "metrics.hxx"
+
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #include <malloc.h>
+#else
+    #include <cerrno>
+    #include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #define BDP_HAS_IO_URING
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+#endif
+
+/// The buffers start on a page boundary, so every block which is copied covers whole pages of the buffer.
+const size_t ASYNC_BUFFER_ALIGNMENT = 4096u;
+
+void* allocateAsyncBuffers(size_t alignment, size_t size) {
+    void* buffers = nullptr;
+
+#ifdef _WIN32
+    buffers = _aligned_malloc(size, alignment);
+#else
+    if(posix_memalign(&buffers, alignment, size) != 0)
+        buffers = nullptr;
+#endif
+
+    if(buffers == nullptr)
+        throw std::bad_alloc();
+
+    return buffers;
+}
+
+void freeAsyncBuffers(void* buffers) {
+#ifdef _WIN32
+    _aligned_free(buffers);
+#else
+    std::free(buffers);
+#endif
+}
+
+// Reads until the length is reached or the file ends, and returns how many bytes were read.
+size_t readAsyncChunk(int file, uint8_t* buffer, size_t length, uint64_t offset) {
+#ifdef _WIN32
+    throw std::runtime_error("Asynchronous file copies are not supported on this platform");
+#else
+    size_t count = 0u;
+
+    while(count < length) {
+        ssize_t result = pread(file, buffer + count, length - count, static_cast<off_t>(offset + count));
+
+        if(result < 0) {
+            if(errno == EINTR)
+                continue;
+
+            throw std::system_error(errno, std::generic_category(), "input");
+        }
+
+        BDP_COUNT(STREAM_READS, 1u);
+
+        if(result == 0)
+            break;
+
+        count += static_cast<size_t>(result);
+    }
+
+    return count;
+#endif
+}
+
+void writeAsyncChunk(int file, const uint8_t* buffer, size_t length, uint64_t offset) {
+#ifdef _WIN32
+    throw std::runtime_error("Asynchronous file copies are not supported on this platform");
+#else
+    size_t count = 0u;
+
+    while(count < length) {
+        ssize_t result = pwrite(file, buffer + count, length - count, static_cast<off_t>(offset + count));
+
+        if(result < 0) {
+            if(errno == EINTR)
+                continue;
+
+            throw std::system_error(errno, std::generic_category(), "output");
+        }
+
+        BDP_COUNT(STREAM_WRITES, 1u);
+        count += static_cast<size_t>(result);
+    }
+#endif
+}
+
+#ifdef BDP_HAS_IO_URING
+
+struct BDP::AsyncCopier::Ring {
+    Ring() = default;
+    ~Ring();
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    bool open(unsigned entries);
+
+    void prepare(uint8_t opcode, int file, const iovec* vector, uint64_t offset, uint64_t userData);
+    void submit(unsigned waitCount);
+    bool peek(io_uring_cqe& completion);
+
+    int file = -1;
+
+    void* submissionRing = MAP_FAILED;
+    size_t submissionRingSize = 0u;
+    void* completionRing = MAP_FAILED;
+    size_t completionRingSize = 0u;
+    io_uring_sqe* entries = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t entriesSize = 0u;
+
+    unsigned* submissionTail = nullptr;
+    unsigned* submissionArray = nullptr;
+    unsigned submissionMask = 0u;
+
+    unsigned* completionHead = nullptr;
+    unsigned* completionTail = nullptr;
+    unsigned completionMask = 0u;
+    io_uring_cqe* completions = nullptr;
+
+    unsigned pending = 0u;
+};
+
+BDP::AsyncCopier::Ring::~Ring() {
+    if(entries != MAP_FAILED)
+        munmap(entries, entriesSize);
+    if(completionRing != MAP_FAILED && completionRing != submissionRing)
+        munmap(completionRing, completionRingSize);
+    if(submissionRing != MAP_FAILED)
+        munmap(submissionRing, submissionRingSize);
+    if(file != -1)
+        close(file);
+}
+
+// Returns false if io_uring is not available (e.g. an old kernel, or blocked by a seccomp filter).
+bool BDP::AsyncCopier::Ring::open(unsigned entryCount) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    long result = syscall(__NR_io_uring_setup, entryCount, &params);
+
+    if(result < 0)
+        return false;
+
+    file = static_cast<int>(result);
+
+    submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        if(completionRingSize > submissionRingSize)
+            submissionRingSize = completionRingSize;
+        completionRingSize = submissionRingSize;
+    }
+
+    submissionRing = mmap(nullptr, submissionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, file, IORING_OFF_SQ_RING);
+
+    if(submissionRing == MAP_FAILED)
+        return false;
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        completionRing = submissionRing;
+    } else {
+        completionRing = mmap(nullptr, completionRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, file, IORING_OFF_CQ_RING);
+
+        if(completionRing == MAP_FAILED)
+            return false;
+    }
+
+    entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+    entries = static_cast<io_uring_sqe*>(mmap(nullptr, entriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, file, IORING_OFF_SQES));
+
+    if(entries == MAP_FAILED)
+        return false;
+
+    uint8_t* submission = static_cast<uint8_t*>(submissionRing);
+    uint8_t* completion = static_cast<uint8_t*>(completionRing);
+
+    submissionTail = reinterpret_cast<unsigned*>(submission + params.sq_off.tail);
+    submissionArray = reinterpret_cast<unsigned*>(submission + params.sq_off.array);
+    submissionMask = *reinterpret_cast<unsigned*>(submission + params.sq_off.ring_mask);
+
+    completionHead = reinterpret_cast<unsigned*>(completion + params.cq_off.head);
+    completionTail = reinterpret_cast<unsigned*>(completion + params.cq_off.tail);
+    completionMask = *reinterpret_cast<unsigned*>(completion + params.cq_off.ring_mask);
+    completions = reinterpret_cast<io_uring_cqe*>(completion + params.cq_off.cqes);
+
+    return true;
+}
+
+void BDP::AsyncCopier::Ring::prepare(uint8_t opcode, int target, const iovec* vector, uint64_t offset, uint64_t userData) {
+    // Only this thread writes the tail, so it can be read without synchronization.
+    unsigned tail = *submissionTail;
+    unsigned index = tail & submissionMask;
+
+    io_uring_sqe* entry = &entries[index];
+    memset(entry, 0, sizeof(io_uring_sqe));
+
+    entry->opcode = opcode;
+    entry->fd = target;
+    entry->addr = reinterpret_cast<uint64_t>(vector);
+    entry->len = 1u;
+    entry->off = offset;
+    entry->user_data = userData;
+
+    submissionArray[index] = index;
+
+    // The entry must be visible to the kernel before the new tail.
+    __atomic_store_n(submissionTail, tail + 1u, __ATOMIC_RELEASE);
+    ++pending;
+}
+
+void BDP::AsyncCopier::Ring::submit(unsigned waitCount) {
+    unsigned flags = waitCount != 0u ? IORING_ENTER_GETEVENTS : 0u;
+
+    while(true) {
+        long result = syscall(__NR_io_uring_enter, file, pending, waitCount, flags, nullptr, 0);
+
+        if(result < 0) {
+            if(errno == EINTR)
+                continue;
+
+            throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+        }
+
+        pending -= static_cast<unsigned>(result);
+
+        if(pending == 0u)
+            return;
+    }
+}
+
+bool BDP::AsyncCopier::Ring::peek(io_uring_cqe& completion) {
+    unsigned head = *completionHead;
+
+    if(head == __atomic_load_n(completionTail, __ATOMIC_ACQUIRE))
+        return false;
+
+    completion = completions[head & completionMask];
+    __atomic_store_n(completionHead, head + 1u, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+#else
+
+struct BDP::AsyncCopier::Ring { };
+
+#endif
+
+BDP::AsyncCopier::AsyncCopier() : AsyncCopier(AsyncOptions()) { }
+
+BDP::AsyncCopier::AsyncCopier(const AsyncOptions& options) : options(options),
+                                                             backend(AsyncBackend::THREADS),
+                                                             buffers(nullptr, &freeAsyncBuffers),
+                                                             ring() {
+    if(options.bufferSize == 0u)
+        throw std::invalid_argument("options: The buffer size must not be 0");
+    if(options.bufferCount == 0u)
+        throw std::invalid_argument("options: The buffer count must be at least 1");
+
+    buffers.reset(static_cast<uint8_t*>(allocateAsyncBuffers(ASYNC_BUFFER_ALIGNMENT, options.bufferSize * options.bufferCount)));
+    BDP_COUNT(BUFFER_ALLOCATIONS, 1u);
+
+#ifdef BDP_HAS_IO_URING
+    if(options.backend != AsyncBackend::THREADS) {
+        ring = std::make_unique<Ring>();
+
+        if(ring->open(static_cast<unsigned>(options.bufferCount))) {
+            backend = AsyncBackend::IO_URING;
+        } else {
+            ring.reset();
+
+            if(options.backend == AsyncBackend::IO_URING)
+                throw std::runtime_error("io_uring is not available");
+        }
+    }
+#else
+    if(options.backend == AsyncBackend::IO_URING)
+        throw std::runtime_error("io_uring is not available");
+#endif
+}
+
+BDP::AsyncCopier::~AsyncCopier() = default;
+
+uint64_t BDP::AsyncCopier::copy(int input, uint64_t inputOffset, int output, uint64_t outputOffset, uint64_t length) {
+    if(length == 0u)
+        return 0u;
+
+    if(backend == AsyncBackend::IO_URING)
+        return copyWithRing(input, inputOffset, output, outputOffset, length);
+
+    return copyWithThreads(input, inputOffset, output, outputOffset, length);
+}
+
+#ifdef BDP_HAS_IO_URING
+
+uint64_t BDP::AsyncCopier::copyWithRing(int input, uint64_t inputOffset, int output, uint64_t outputOffset, uint64_t length) {
+    enum class SlotState { FREE, READING, WRITING };
+
+    struct Slot {
+        SlotState state;
+        uint64_t position;
+        size_t length;
+        size_t done;
+        iovec vector;
+    };
+
+    std::vector<Slot> slots(options.bufferCount, Slot{ SlotState::FREE, 0u, 0u, 0u, iovec() });
+
+    uint64_t limit = length;
+    uint64_t readPosition = 0u;
+    uint64_t written = 0u;
+    size_t inFlight = 0u;
+    int error = 0;
+
+    auto queueRead = [&](size_t index) {
+        Slot& slot = slots[index];
+
+        slot.vector.iov_base = getBuffer(index) + slot.done;
+        slot.vector.iov_len = slot.length - slot.done;
+
+        ring->prepare(IORING_OP_READV, input, &slot.vector, inputOffset + slot.position + slot.done, index);
+    };
+    auto queueWrite = [&](size_t index) {
+        Slot& slot = slots[index];
+
+        slot.vector.iov_base = getBuffer(index) + slot.done;
+        slot.vector.iov_len = slot.length - slot.done;
+
+        ring->prepare(IORING_OP_WRITEV, output, &slot.vector, outputOffset + slot.position + slot.done, index);
+    };
+
+    // Every buffer is either free, being filled from the input, or being drained to the output,
+    // so up to bufferCount reads and writes overlap.
+    while(true) {
+        for(size_t i = 0u; i < slots.size() && readPosition < limit && error == 0; ++i) {
+            if(slots[i].state != SlotState::FREE)
+                continue;
+
+            uint64_t remaining = limit - readPosition;
+
+            slots[i].state = SlotState::READING;
+            slots[i].position = readPosition;
+            slots[i].length = remaining < options.bufferSize ? static_cast<size_t>(remaining) : options.bufferSize;
+            slots[i].done = 0u;
+
+            queueRead(i);
+
+            readPosition += slots[i].length;
+            ++inFlight;
+        }
+
+        if(inFlight == 0u)
+            break;
+
+        ring->submit(1u);
+
+        io_uring_cqe completion;
+
+        while(ring->peek(completion)) {
+            size_t index = static_cast<size_t>(completion.user_data);
+            Slot& slot = slots[index];
+
+            if(completion.res < 0 && (completion.res == -EINTR || completion.res == -EAGAIN) && error == 0) {
+                if(slot.state == SlotState::READING)
+                    queueRead(index);
+                else
+                    queueWrite(index);
+
+                continue;
+            }
+
+            if(completion.res < 0 || error != 0) {
+                // Stop issuing requests, and wait for the ones which are in flight before reporting the error.
+                if(error == 0)
+                    error = -completion.res;
+
+                slot.state = SlotState::FREE;
+                --inFlight;
+
+                continue;
+            }
+
+            size_t count = static_cast<size_t>(completion.res);
+
+            if(slot.state == SlotState::READING) {
+                BDP_COUNT(STREAM_READS, 1u);
+
+                if(count == 0u) {
+                    // The input ended; nothing after this position can be copied.
+                    if(slot.position + slot.done < limit)
+                        limit = slot.position + slot.done;
+
+                    if(slot.done == 0u) {
+                        slot.state = SlotState::FREE;
+                        --inFlight;
+
+                        continue;
+                    }
+
+                    slot.length = slot.done;
+                } else {
+                    slot.done += count;
+
+                    if(slot.done < slot.length) {
+                        queueRead(index);
+                        continue;
+                    }
+                }
+
+                slot.state = SlotState::WRITING;
+                slot.done = 0u;
+
+                queueWrite(index);
+            } else {
+                BDP_COUNT(STREAM_WRITES, 1u);
+
+                if(count == 0u) {
+                    error = EIO;
+
+                    slot.state = SlotState::FREE;
+                    --inFlight;
+
+                    continue;
+                }
+
+                slot.done += count;
+
+                if(slot.done < slot.length) {
+                    queueWrite(index);
+                    continue;
+                }
+
+                written += slot.length;
+
+                slot.state = SlotState::FREE;
+                --inFlight;
+            }
+        }
+    }
+
+    if(error != 0)
+        throw std::system_error(error, std::generic_category(), "copy");
+
+    return written;
+}
+
+#else
+
+uint64_t BDP::AsyncCopier::copyWithRing(int input, uint64_t inputOffset, int output, uint64_t outputOffset, uint64_t length) {
+    return copyWithThreads(input, inputOffset, output, outputOffset, length);
+}
+
+#endif
+
+uint64_t BDP::AsyncCopier::copyWithThreads(int input, uint64_t inputOffset, int output, uint64_t outputOffset, uint64_t length) {
+    uint64_t position = 0u;
+
+    // There is nothing to overlap, so copy on this thread.
+    if(length <= options.bufferSize || options.bufferCount < 2u) {
+        uint8_t* buffer = getBuffer(0u);
+
+        while(position < length) {
+            uint64_t remaining = length - position;
+            size_t wanted = remaining < options.bufferSize ? static_cast<size_t>(remaining) : options.bufferSize;
+            size_t count = readAsyncChunk(input, buffer, wanted, inputOffset + position);
+
+            if(count == 0u)
+                break;
+
+            writeAsyncChunk(output, buffer, count, outputOffset + position);
+            position += count;
+
+            if(count < wanted)
+                break;
+        }
+
+        return position;
+    }
+
+    struct Chunk {
+        size_t index;
+        uint64_t position;
+        size_t length;
+    };
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Chunk> filled;
+    std::vector<size_t> free;
+    bool finished = false;
+    std::exception_ptr writeError;
+
+    for(size_t i = 0u; i < options.bufferCount; ++i)
+        free.push_back(i);
+
+    // This thread reads while the writer thread drains the filled buffers.
+    std::thread writer([&]() {
+        try {
+            while(true) {
+                Chunk chunk;
+
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [&]() { return !filled.empty() || finished; });
+
+                    if(filled.empty())
+                        return;
+
+                    chunk = filled.front();
+                    filled.pop_front();
+                }
+
+                writeAsyncChunk(output, getBuffer(chunk.index), chunk.length, outputOffset + chunk.position);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    free.push_back(chunk.index);
+                }
+
+                condition.notify_all();
+            }
+        } catch(...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                writeError = std::current_exception();
+            }
+
+            condition.notify_all();
+        }
+    });
+
+    std::exception_ptr readError;
+
+    try {
+        while(position < length) {
+            size_t index;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&]() { return !free.empty() || writeError; });
+
+                if(writeError)
+                    break;
+
+                index = free.back();
+                free.pop_back();
+            }
+
+            uint64_t remaining = length - position;
+            size_t wanted = remaining < options.bufferSize ? static_cast<size_t>(remaining) : options.bufferSize;
+            size_t count = readAsyncChunk(input, getBuffer(index), wanted, inputOffset + position);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if(count == 0u)
+                    free.push_back(index);
+                else
+                    filled.push_back({ index, position, count });
+            }
+
+            condition.notify_all();
+            position += count;
+
+            if(count < wanted)
+                break;
+        }
+    } catch(...) {
+        readError = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+
+    condition.notify_all();
+    writer.join();
+
+    if(readError)
+        std::rethrow_exception(readError);
+    if(writeError)
+        std::rethrow_exception(writeError);
+
+    return position;
+}
+
+size_t BDP::writeFileName(const BDP::Header* header, int output, uint64_t outputOffset, int name, uint64_t nameOffset, size_t nameLength, AsyncCopier& copier) {
+    return writeFileData(header->NAME_MAX_LENGTH, header->NAME_LENGTH_BYTE_SIZE, output, outputOffset, name, nameOffset, nameLength, copier);
+}
+size_t BDP::writeFileValue(const BDP::Header* header, int output, uint64_t outputOffset, int value, uint64_t valueOffset, size_t valueLength, AsyncCopier& copier) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
+    return writeFileData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, outputOffset, value, valueOffset, valueLength, copier);
+}
+size_t BDP::writeFileData(size_t maxLength, uint8_t lengthByteSize, int output, uint64_t outputOffset, int data, uint64_t dataOffset, size_t dataLength, AsyncCopier& copier) {
+    BDP_TIME(WRITE_DATA);
+
+    if(dataLength > maxLength)
+        throw std::invalid_argument("dataLength");
+
+    uint8_t dataLengthBytes[sizeof(size_t)];
+    lengthToBytes(dataLengthBytes, dataLength, lengthByteSize);
+
+    writeAsyncChunk(output, dataLengthBytes, lengthByteSize, outputOffset);
+
+    if(copier.copy(data, dataOffset, output, outputOffset + lengthByteSize, dataLength) != dataLength)
+        throw std::runtime_error("data: The file ended before the specified length was reached");
+
+    BDP_COUNT(BYTES_WRITTEN, lengthByteSize + dataLength);
+
+    return lengthByteSize + dataLength;
+}
+
+size_t BDP::readFileName(const BDP::Header* header, int input, uint64_t inputOffset, int name, uint64_t nameOffset, size_t* nameLength, AsyncCopier& copier) {
+    return readFileData(header->NAME_LENGTH_BYTE_SIZE, input, inputOffset, name, nameOffset, nameLength, copier);
+}
+size_t BDP::readFileValue(const BDP::Header* header, int input, uint64_t inputOffset, int value, uint64_t valueOffset, size_t* valueLength, AsyncCopier& copier) {
+    BDP_COUNT(PAIRS_READ, 1u);
+
+    return readFileData(header->VALUE_LENGTH_BYTE_SIZE, input, inputOffset, value, valueOffset, valueLength, copier);
+}
+size_t BDP::readFileData(uint8_t lengthByteSize, int input, uint64_t inputOffset, int output, uint64_t outputOffset, size_t* outputLength, AsyncCopier& copier) {
+    BDP_TIME(READ_DATA);
+
+    uint8_t lengthBytes[sizeof(size_t)];
+    size_t length = 0u;
+
+    if(readAsyncChunk(input, lengthBytes, lengthByteSize, inputOffset) != lengthByteSize)
+        throw std::runtime_error("input: Truncated data length");
+
+    bytesToLength(length, lengthBytes, lengthByteSize);
+
+    if(copier.copy(input, inputOffset + lengthByteSize, output, outputOffset, length) != length)
+        throw std::runtime_error("input: Truncated data");
+
+    BDP_COUNT(BYTES_READ, lengthByteSize + length);
+
+    if(outputLength != nullptr)
+        *outputLength = length;
+
+    return lengthByteSize + length;
+}
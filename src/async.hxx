@@ -0,0 +1,87 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_ASYNC_HXX_INCLUDED
+#define BDP_ASYNC_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace BDP {
+    const size_t DEFAULT_ASYNC_BUFFER_SIZE = 1048576u;
+    const size_t DEFAULT_ASYNC_BUFFER_COUNT = 4u;
+
+    enum class AsyncBackend {
+        AUTO,
+        IO_URING,
+        THREADS
+    };
+
+    struct AsyncOptions {
+        size_t bufferSize = DEFAULT_ASYNC_BUFFER_SIZE;
+        size_t bufferCount = DEFAULT_ASYNC_BUFFER_COUNT;
+        AsyncBackend backend = AsyncBackend::AUTO;
+    };
+
+    class AsyncCopier {
+    public:
+        AsyncCopier();
+        explicit AsyncCopier(const AsyncOptions& options);
+        ~AsyncCopier();
+
+        AsyncCopier(const AsyncCopier&) = delete;
+        AsyncCopier& operator=(const AsyncCopier&) = delete;
+
+        uint64_t copy(int input, uint64_t inputOffset, int output, uint64_t outputOffset, uint64_t length);
+
+        AsyncBackend getBackend() const { return backend; }
+        const AsyncOptions& getOptions() const { return options; }
+
+    private:
+        struct Ring;
+
+        uint64_t copyWithRing(int input, uint64_t inputOffset, int output, uint64_t outputOffset, uint64_t length);
+        uint64_t copyWithThreads(int input, uint64_t inputOffset, int output, uint64_t outputOffset, uint64_t length);
+
+        uint8_t* getBuffer(size_t index) const { return buffers.get() + index * options.bufferSize; }
+
+        AsyncOptions options;
+        AsyncBackend backend;
+
+        std::unique_ptr<uint8_t, void (*)(void*)> buffers;
+        std::unique_ptr<Ring> ring;
+    };
+
+    size_t writeFileName(const Header* header, int output, uint64_t outputOffset, int name, uint64_t nameOffset, size_t nameLength, AsyncCopier& copier);
+    size_t writeFileValue(const Header* header, int output, uint64_t outputOffset, int value, uint64_t valueOffset, size_t valueLength, AsyncCopier& copier);
+    size_t writeFileData(size_t maxLength, uint8_t lengthByteSize, int output, uint64_t outputOffset, int data, uint64_t dataOffset, size_t dataLength, AsyncCopier& copier);
+
+    size_t readFileName(const Header* header, int input, uint64_t inputOffset, int name, uint64_t nameOffset, size_t* nameLength, AsyncCopier& copier);
+    size_t readFileValue(const Header* header, int input, uint64_t inputOffset, int value, uint64_t valueOffset, size_t* valueLength, AsyncCopier& copier);
+    size_t readFileData(uint8_t lengthByteSize, int input, uint64_t inputOffset, int output, uint64_t outputOffset, size_t* outputLength, AsyncCopier& copier);
+}
+
+#endif
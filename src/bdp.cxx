@@ -21,15 +21,24 @@
  */
 
 #include "bdp.hxx"
+#include "metrics.hxx"
 
+#include <cstdio>
 #include <memory>
+#include <vector>
 
 /// The magic BDP value, which is located at the beginning of every BDP package.
 const char* MAGIC_VALUE = "BDP";
 /// The magic BDP value length.
 const uint8_t MAGIC_VALUE_LENGTH = 3u;
+/// The magic value of packages with an extended header.
+const char* EXTENDED_MAGIC_VALUE = "BDX";
+/// The header flags which this version of the library can read.
+const uint8_t KNOWN_HEADER_FLAGS = BDP::HEADER_FLAG_COMPRESSED | BDP::HEADER_FLAG_CHECKSUMMED | BDP::HEADER_FLAG_NAME_DICTIONARY;
 /// The default size of the buffer used to copy data from one stream to another.
 const size_t DEFAULT_BUFFER_SIZE = 16384u;
+/// The default amount of data which is spooled in memory before spilling to a temporary file.
+const size_t DEFAULT_SPOOL_SIZE = 1048576u;
 
 void checkByteSize(uint8_t byteSize) {
     if constexpr(sizeof(size_t) < 8)
@@ -37,14 +46,17 @@ void checkByteSize(uint8_t byteSize) {
             throw std::runtime_error("Cannot process 64-bit BDP packages with this version of the library; use the 64-bit version instead");
 }
 
-BDP::Header::Header(uint8_t nlbs, uint8_t vlbs) : NAME_MAX_LENGTH(getMaxLength(nlbs)),
-                                                  VALUE_MAX_LENGTH(getMaxLength(vlbs)),
-                                                  NAME_LENGTH_BIT_SIZE(nlbs),
-                                                  VALUE_LENGTH_BIT_SIZE(vlbs),
-                                                  NAME_LENGTH_BYTE_SIZE(nlbs / 8u),
-                                                  VALUE_LENGTH_BYTE_SIZE(vlbs / 8u) { }
+BDP::Header::Header(uint8_t nlbs, uint8_t vlbs) : Header(nlbs, vlbs, 0u) { }
 
-BDP::Header* BDP::writeHeader(std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
+BDP::Header::Header(uint8_t nlbs, uint8_t vlbs, uint8_t flags) : NAME_MAX_LENGTH(getMaxLength(nlbs)),
+                                                                 VALUE_MAX_LENGTH(getMaxLength(vlbs)),
+                                                                 NAME_LENGTH_BIT_SIZE(nlbs),
+                                                                 VALUE_LENGTH_BIT_SIZE(vlbs),
+                                                                 NAME_LENGTH_BYTE_SIZE(nlbs / 8u),
+                                                                 VALUE_LENGTH_BYTE_SIZE(vlbs / 8u),
+                                                                 FLAGS(flags) { }
+
+void BDP::encodeHeader(uint8_t* output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
     if (nameLengthBitSize != 8u && nameLengthBitSize != 16u && nameLengthBitSize != 32u && nameLengthBitSize != 64u)
         throw std::invalid_argument("nameLengthBitSize");
     if (valueLengthBitSize != 8u && valueLengthBitSize != 16u && valueLengthBitSize != 32u && valueLengthBitSize != 64u)
@@ -55,25 +67,91 @@ BDP::Header* BDP::writeHeader(std::ostream& output, uint8_t nameLengthBitSize, u
 
     uint8_t lengthBitSizes = (((nameLengthBitSize) << 1u) | (valueLengthBitSize >> 3u));
 
-    output.write(MAGIC_VALUE, MAGIC_VALUE_LENGTH);
-    output.write((char*) (&lengthBitSizes), 1u);
-
-    return new BDP::Header(nameLengthBitSize, valueLengthBitSize);
+    memcpy(output, MAGIC_VALUE, MAGIC_VALUE_LENGTH);
+    memcpy(output + MAGIC_VALUE_LENGTH, &lengthBitSizes, 1u);
 }
 
-BDP::Header* BDP::writeHeader(uint8_t* output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
-    if (nameLengthBitSize != 8u && nameLengthBitSize != 16u && nameLengthBitSize != 32u && nameLengthBitSize != 64u)
-        throw std::invalid_argument("nameLengthBitSize");
-    if (valueLengthBitSize != 8u && valueLengthBitSize != 16u && valueLengthBitSize != 32u && valueLengthBitSize != 64u)
-        throw std::invalid_argument("valueLengthBitSize");
+BDP::Header BDP::decodeHeader(const uint8_t* input) {
+    if(memcmp(input, MAGIC_VALUE, MAGIC_VALUE_LENGTH) != 0)
+        throw std::invalid_argument("input");
+
+    uint8_t lengthBitSizes = input[MAGIC_VALUE_LENGTH];
+    uint8_t nameLengthBitSize = 64u;
+    uint8_t valueLengthBitSize = 64u;
+
+    for(uint8_t i = 7u; i >= 4u; --i, nameLengthBitSize >>= 1)
+        if(lengthBitSizes & (1u << i))
+            break;
+
+    if(nameLengthBitSize < 8u)
+        throw std::invalid_argument("input: Invalid package header");
+
+    for(uint8_t i = 4u; i > 0u; --i, valueLengthBitSize >>= 1)
+        if(lengthBitSizes & (1u << (i - 1u)))
+            break;
+
+    if(valueLengthBitSize < 8u)
+        throw std::invalid_argument("input: Invalid package header");
 
     checkByteSize(nameLengthBitSize / 8);
     checkByteSize(valueLengthBitSize / 8);
 
-    uint8_t lengthBitSizes = (((nameLengthBitSize) << 1u) | (valueLengthBitSize >> 3u));
+    return BDP::Header(nameLengthBitSize, valueLengthBitSize);
+}
 
-    memcpy(output, MAGIC_VALUE, MAGIC_VALUE_LENGTH);
-    memcpy(output + MAGIC_VALUE_LENGTH, &lengthBitSizes, 1u);
+// Packages without flags keep the plain header, so they stay readable by every reader.
+size_t BDP::encodeExtendedHeader(uint8_t* output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, uint8_t flags) {
+    if((flags & ~KNOWN_HEADER_FLAGS) != 0u)
+        throw std::invalid_argument("flags");
+
+    encodeHeader(output, nameLengthBitSize, valueLengthBitSize);
+
+    if(flags == 0u)
+        return HEADER_LENGTH;
+
+    memcpy(output, EXTENDED_MAGIC_VALUE, MAGIC_VALUE_LENGTH);
+    output[HEADER_LENGTH] = flags;
+
+    return EXTENDED_HEADER_LENGTH;
+}
+
+BDP::Header BDP::decodeExtendedHeader(const uint8_t* input) {
+    if(memcmp(input, EXTENDED_MAGIC_VALUE, MAGIC_VALUE_LENGTH) != 0)
+        return decodeHeader(input);
+
+    uint8_t flags = input[HEADER_LENGTH];
+
+    // An extended header without flags is never written, and unknown flags change how the data must be read.
+    if(flags == 0u || (flags & ~KNOWN_HEADER_FLAGS) != 0u)
+        throw std::invalid_argument("input: Unsupported package flags");
+
+    uint8_t bytes[HEADER_LENGTH];
+    memcpy(bytes, MAGIC_VALUE, MAGIC_VALUE_LENGTH);
+    bytes[MAGIC_VALUE_LENGTH] = input[MAGIC_VALUE_LENGTH];
+
+    Header header = decodeHeader(bytes);
+
+    return BDP::Header(header.NAME_LENGTH_BIT_SIZE, header.VALUE_LENGTH_BIT_SIZE, flags);
+}
+
+size_t BDP::getHeaderLength(const BDP::Header* header) {
+    return header->FLAGS != 0u ? EXTENDED_HEADER_LENGTH : HEADER_LENGTH;
+}
+
+BDP::Header* BDP::writeHeader(std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
+    BDP_TIME(WRITE_HEADER);
+    uint8_t bytes[HEADER_LENGTH];
+    encodeHeader(bytes, nameLengthBitSize, valueLengthBitSize);
+
+    output.write((char*) (&bytes[0]), HEADER_LENGTH);
+    BDP_COUNT(STREAM_WRITES, 1u);
+
+    return new BDP::Header(nameLengthBitSize, valueLengthBitSize);
+}
+
+BDP::Header* BDP::writeHeader(uint8_t* output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
+    BDP_TIME(WRITE_HEADER);
+    encodeHeader(output, nameLengthBitSize, valueLengthBitSize);
 
     return new BDP::Header(nameLengthBitSize, valueLengthBitSize);
 }
@@ -98,24 +176,70 @@ size_t BDP::writeName(const BDP::Header* header, uint8_t* output, std::istream&
 }
 
 size_t BDP::writeValue(const BDP::Header* header, std::ostream& output, const uint8_t* value, size_t valueLength) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
     return writeData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, value, valueLength);
 }
 size_t BDP::writeValue(const BDP::Header* header, uint8_t* output, const uint8_t* value, size_t valueLength) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
     return writeData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, value, valueLength);
 }
 size_t BDP::writeValue(const BDP::Header* header, std::ostream& output, std::istream& value) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
     return writeData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, value, DEFAULT_BUFFER_SIZE);
 }
 size_t BDP::writeValue(const BDP::Header* header, std::ostream& output, std::istream& value, size_t bufferSize) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
     return writeData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, value, bufferSize);
 }
 size_t BDP::writeValue(const BDP::Header* header, uint8_t* output, std::istream& value) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
     return writeData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, value, DEFAULT_BUFFER_SIZE);
 }
 size_t BDP::writeValue(const BDP::Header* header, uint8_t* output, std::istream& value, size_t bufferSize) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
     return writeData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, value, bufferSize);
 }
 
+size_t BDP::writeSizedName(const BDP::Header* header, std::ostream& output, std::istream& name, size_t nameLength) {
+    return writeSizedData(header->NAME_MAX_LENGTH, header->NAME_LENGTH_BYTE_SIZE, output, name, nameLength, DEFAULT_BUFFER_SIZE);
+}
+size_t BDP::writeSizedName(const BDP::Header* header, std::ostream& output, std::istream& name, size_t nameLength, size_t bufferSize) {
+    return writeSizedData(header->NAME_MAX_LENGTH, header->NAME_LENGTH_BYTE_SIZE, output, name, nameLength, bufferSize);
+}
+size_t BDP::writeSpooledName(const BDP::Header* header, std::ostream& output, std::istream& name) {
+    return writeSpooledData(header->NAME_MAX_LENGTH, header->NAME_LENGTH_BYTE_SIZE, output, name, DEFAULT_BUFFER_SIZE, DEFAULT_SPOOL_SIZE);
+}
+size_t BDP::writeSpooledName(const BDP::Header* header, std::ostream& output, std::istream& name, size_t bufferSize, size_t spoolSize) {
+    return writeSpooledData(header->NAME_MAX_LENGTH, header->NAME_LENGTH_BYTE_SIZE, output, name, bufferSize, spoolSize);
+}
+
+size_t BDP::writeSizedValue(const BDP::Header* header, std::ostream& output, std::istream& value, size_t valueLength) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
+    return writeSizedData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, value, valueLength, DEFAULT_BUFFER_SIZE);
+}
+size_t BDP::writeSizedValue(const BDP::Header* header, std::ostream& output, std::istream& value, size_t valueLength, size_t bufferSize) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
+    return writeSizedData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, value, valueLength, bufferSize);
+}
+size_t BDP::writeSpooledValue(const BDP::Header* header, std::ostream& output, std::istream& value) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
+    return writeSpooledData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, value, DEFAULT_BUFFER_SIZE, DEFAULT_SPOOL_SIZE);
+}
+size_t BDP::writeSpooledValue(const BDP::Header* header, std::ostream& output, std::istream& value, size_t bufferSize, size_t spoolSize) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
+    return writeSpooledData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, value, bufferSize, spoolSize);
+}
+
 size_t BDP::writePair(const BDP::Header* header, std::ostream& output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
     return writeName(header, output, name, nameLength) +
            writeValue(header, output, value, valueLength);
@@ -174,47 +298,67 @@ size_t BDP::writePair(const BDP::Header* header, uint8_t* output, std::istream&
 }
 
 size_t BDP::writeData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, const uint8_t* data, size_t dataLength) {
+    BDP_TIME(WRITE_DATA);
     checkByteSize(lengthByteSize);
 
     if(isLittleEndian()) {
         output.write(reinterpret_cast<char*>(&dataLength), lengthByteSize);
     } else {
-        auto dataLengthBytes = std::make_unique<uint8_t[]>(lengthByteSize);
-        reversedValueToBytes(dataLengthBytes.get(), dataLength, lengthByteSize);
+        uint8_t dataLengthBytes[sizeof(size_t)];
+        reversedValueToBytes(dataLengthBytes, dataLength, lengthByteSize);
 
         output.write((char*) (&dataLengthBytes[0]), lengthByteSize);
     }
 
     output.write((char*) (&data[0]), dataLength);
 
+    BDP_COUNT(STREAM_WRITES, 2u);
+    BDP_COUNT(BYTES_WRITTEN, lengthByteSize + dataLength);
+
     return lengthByteSize + dataLength;
 }
 size_t BDP::writeData(size_t maxLength, uint8_t lengthByteSize, uint8_t* output, const uint8_t* data, size_t dataLength) {
+    BDP_TIME(WRITE_DATA);
     lengthToBytes(output, dataLength, lengthByteSize);
 
     memcpy(output + lengthByteSize, data, static_cast<size_t>(dataLength));
 
+    BDP_COUNT(BYTES_WRITTEN, lengthByteSize + dataLength);
+
     return lengthByteSize + dataLength;
 }
 size_t BDP::writeData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, std::istream& data, size_t bufferSize) {
+    auto buffer = std::make_unique<uint8_t[]>(bufferSize);
+    BDP_COUNT(BUFFER_ALLOCATIONS, 1u);
+
+    return writeData(maxLength, lengthByteSize, output, data, buffer.get(), bufferSize);
+}
+size_t BDP::writeData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, std::istream& data, uint8_t* buffer, size_t bufferSize) {
+    BDP_TIME(WRITE_DATA);
     checkByteSize(lengthByteSize);
 
     size_t inputLength = 0u;
     size_t diff;
     size_t nextLength;
 
-    auto buffer = std::make_unique<char[]>(static_cast<size_t>(bufferSize));
-
     std::streampos lastPos = output.tellp();
+    BDP_COUNT(SEEKS, 1u);
+
+    // The output can't seek back to patch the length (e.g. a pipe or socket), so spool the data instead.
+    if(lastPos == std::streampos(-1))
+        return writeSpooledData(maxLength, lengthByteSize, output, data, buffer, bufferSize, DEFAULT_SPOOL_SIZE);
 
     // Write a placeholder value, as the actual length is unknown yet.
     output.write(reinterpret_cast<char*>(&inputLength), lengthByteSize);
 
     while((diff = maxLength - inputLength) != 0u && !data.eof()) {
         nextLength = diff < bufferSize ? diff : bufferSize;
-        data.read(buffer.get(), nextLength);
-        output.write(buffer.get(), data.gcount());
+        data.read(reinterpret_cast<char*>(buffer), nextLength);
+        output.write(reinterpret_cast<char*>(buffer), data.gcount());
         inputLength += static_cast<size_t>(data.gcount());
+
+        BDP_COUNT(STREAM_READS, 1u);
+        BDP_COUNT(STREAM_WRITES, 1u);
     }
 
     std::streampos endPos = output.tellp();
@@ -224,17 +368,23 @@ size_t BDP::writeData(size_t maxLength, uint8_t lengthByteSize, std::ostream& ou
     if(isLittleEndian()) {
         output.write(reinterpret_cast<char*>(&inputLength), lengthByteSize);
     } else {
-        auto inputLengthBytes = std::make_unique<uint8_t[]>(lengthByteSize);
-        reversedValueToBytes(inputLengthBytes.get(), inputLength, lengthByteSize);
+        uint8_t inputLengthBytes[sizeof(size_t)];
+        reversedValueToBytes(inputLengthBytes, inputLength, lengthByteSize);
 
         output.write((char*) (&inputLengthBytes[0]), lengthByteSize);
     }
 
     output.seekp(endPos);
 
+    BDP_COUNT(SEEKS, 3u);
+    BDP_COUNT(STREAM_WRITES, 2u);
+    BDP_COUNT(BYTES_WRITTEN, lengthByteSize + inputLength);
+
     return lengthByteSize + inputLength;
 }
 size_t BDP::writeData(size_t maxLength, uint8_t lengthByteSize, uint8_t* output, std::istream& data, size_t bufferSize) {
+    BDP_TIME(WRITE_DATA);
+
     size_t inputLength = 0u;
     size_t index = 0;
     size_t diff;
@@ -251,85 +401,194 @@ size_t BDP::writeData(size_t maxLength, uint8_t lengthByteSize, uint8_t* output,
 
         index += static_cast<size_t>(data.gcount());
         inputLength += static_cast<size_t>(data.gcount());
+
+        BDP_COUNT(STREAM_READS, 1u);
     }
 
     // Write the actual length.
     lengthToBytes(output, inputLength, lengthByteSize);
 
+    BDP_COUNT(BYTES_WRITTEN, lengthByteSize + inputLength);
+
     return lengthByteSize + inputLength;
 }
 
-BDP::Header* BDP::readHeader(std::istream& input) {
-    auto magic = std::make_unique<char[]>(MAGIC_VALUE_LENGTH + 1u);
-    input.read(magic.get(), MAGIC_VALUE_LENGTH);
+size_t BDP::writeSizedData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, std::istream& data, size_t dataLength, size_t bufferSize) {
+    auto buffer = std::make_unique<uint8_t[]>(bufferSize);
+    BDP_COUNT(BUFFER_ALLOCATIONS, 1u);
 
-    magic[MAGIC_VALUE_LENGTH] = '\0';
+    return writeSizedData(maxLength, lengthByteSize, output, data, dataLength, buffer.get(), bufferSize);
+}
+size_t BDP::writeSizedData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, std::istream& data, size_t dataLength, uint8_t* buffer, size_t bufferSize) {
+    BDP_TIME(WRITE_DATA);
+    checkByteSize(lengthByteSize);
 
-    if(strcmp(magic.get(), MAGIC_VALUE) != 0)
-        throw std::invalid_argument("input");
+    if(dataLength > maxLength)
+        throw std::invalid_argument("dataLength");
 
-    uint8_t nameLengthBitSize = 64u;
-    uint8_t valueLengthBitSize = 64u;
+    uint8_t dataLengthBytes[sizeof(size_t)];
+    lengthToBytes(dataLengthBytes, dataLength, lengthByteSize);
 
-    auto lengthBitSizes = std::make_unique<uint8_t>();
-    input.read((char*) lengthBitSizes.get(), 1u);
+    // The length is known, so it can be written first and the output never has to seek.
+    output.write((char*) (&dataLengthBytes[0]), lengthByteSize);
 
-    for(uint8_t i = 7u; i >= 4u; --i, nameLengthBitSize >>= 1)
-        if(*lengthBitSizes.get() & (1u << i))
-            break;
+    size_t remaining = dataLength;
+    size_t nextLength;
 
-    if(nameLengthBitSize == 0)
-        throw std::invalid_argument("input: Invalid package header");
+    while(remaining > 0u) {
+        nextLength = remaining < bufferSize ? remaining : bufferSize;
+        data.read(reinterpret_cast<char*>(buffer), nextLength);
 
-    for(uint8_t i = 3u; i >= 0u; --i, valueLengthBitSize >>= 1)
-        if (*lengthBitSizes.get() & (1u << i))
+        // A stream which failed without reaching its end reads nothing, and never sets eofbit.
+        if(data.gcount() == 0)
+            throw std::runtime_error("data: The stream ended before the specified length was reached");
+
+        output.write(reinterpret_cast<char*>(buffer), data.gcount());
+        remaining -= static_cast<size_t>(data.gcount());
+
+        BDP_COUNT(STREAM_READS, 1u);
+        BDP_COUNT(STREAM_WRITES, 1u);
+    }
+
+    BDP_COUNT(STREAM_WRITES, 1u);
+    BDP_COUNT(BYTES_WRITTEN, lengthByteSize + dataLength);
+
+    return lengthByteSize + dataLength;
+}
+size_t BDP::writeSpooledData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, std::istream& data, size_t bufferSize, size_t spoolSize) {
+    auto buffer = std::make_unique<uint8_t[]>(bufferSize);
+    BDP_COUNT(BUFFER_ALLOCATIONS, 1u);
+
+    return writeSpooledData(maxLength, lengthByteSize, output, data, buffer.get(), bufferSize, spoolSize);
+}
+size_t BDP::writeSpooledData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, std::istream& data, uint8_t* buffer, size_t bufferSize, size_t spoolSize) {
+    BDP_TIME(WRITE_DATA);
+    checkByteSize(lengthByteSize);
+
+    size_t inputLength = 0u;
+    size_t diff;
+    size_t nextLength;
+
+    std::vector<uint8_t> spool;
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> spill(nullptr, &std::fclose);
+
+    // Keep the data in memory until the spool size is exceeded, then spill the rest to a temporary file.
+    while((diff = maxLength - inputLength) != 0u && !data.eof()) {
+        nextLength = diff < bufferSize ? diff : bufferSize;
+        data.read(reinterpret_cast<char*>(buffer), nextLength);
+
+        size_t count = static_cast<size_t>(data.gcount());
+
+        // A stream which failed without reaching its end reads nothing, and never sets eofbit.
+        if(count == 0u) {
+            if(!data.eof())
+                throw std::runtime_error("data: The stream failed before its end was reached");
             break;
+        }
 
-    if(valueLengthBitSize == 0)
-        throw std::invalid_argument("input: Invalid package header");
+        if(!spill && spool.size() + count <= spoolSize) {
+            spool.insert(spool.end(), buffer, buffer + count);
+        } else {
+            if(!spill) {
+                spill.reset(std::tmpfile());
 
-    checkByteSize(nameLengthBitSize / 8);
-    checkByteSize(valueLengthBitSize / 8);
+                if(!spill)
+                    throw std::runtime_error("Cannot create a temporary spool file");
+            }
 
-    return new BDP::Header(nameLengthBitSize, valueLengthBitSize);
+            if(std::fwrite(buffer, 1u, count, spill.get()) != count)
+                throw std::runtime_error("Cannot write to the temporary spool file");
+        }
+
+        inputLength += count;
+
+        BDP_COUNT(STREAM_READS, 1u);
+    }
+
+    uint8_t inputLengthBytes[sizeof(size_t)];
+    lengthToBytes(inputLengthBytes, inputLength, lengthByteSize);
+
+    output.write((char*) (&inputLengthBytes[0]), lengthByteSize);
+    output.write(reinterpret_cast<char*>(spool.data()), spool.size());
+
+    if(spill) {
+        std::rewind(spill.get());
+
+        size_t count;
+        while((count = std::fread(buffer, 1u, bufferSize, spill.get())) != 0u) {
+            output.write(reinterpret_cast<char*>(buffer), count);
+            BDP_COUNT(STREAM_WRITES, 1u);
+        }
+
+        // The length was already written, so a short read must not go unnoticed.
+        if(std::ferror(spill.get()))
+            throw std::runtime_error("Cannot read the temporary spool file");
+    }
+
+    BDP_COUNT(STREAM_WRITES, 2u);
+    BDP_COUNT(BYTES_WRITTEN, lengthByteSize + inputLength);
+
+    return lengthByteSize + inputLength;
 }
-BDP::Header* BDP::readHeader(const uint8_t* input) {
-    size_t index = 0;
 
-    auto magic = std::make_unique<char[]>(MAGIC_VALUE_LENGTH + 1u);
-    memcpy(magic.get(), input, MAGIC_VALUE_LENGTH);
+BDP::Header* BDP::readHeader(std::istream& input) {
+    BDP_TIME(READ_HEADER);
+    uint8_t bytes[HEADER_LENGTH];
 
-    index += MAGIC_VALUE_LENGTH;
-    magic[MAGIC_VALUE_LENGTH] = '\0';
+    input.read((char*) (&bytes[0]), HEADER_LENGTH);
+    BDP_COUNT(STREAM_READS, 1u);
 
-    if(strcmp(magic.get(), MAGIC_VALUE) != 0)
+    if(static_cast<size_t>(input.gcount()) != HEADER_LENGTH)
         throw std::invalid_argument("input");
 
-    uint8_t nameLengthBitSize = 64u;
-    uint8_t valueLengthBitSize = 64u;
+    return new BDP::Header(decodeHeader(bytes));
+}
+BDP::Header* BDP::readHeader(const uint8_t* input) {
+    BDP_TIME(READ_HEADER);
+    return new BDP::Header(decodeHeader(input));
+}
 
-    auto lengthBitSizes = std::make_unique<uint8_t>();
-    memcpy(lengthBitSizes.get(), input + index, 1);
-    ++index;
+BDP::Header* BDP::writeExtendedHeader(std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, uint8_t flags) {
+    BDP_TIME(WRITE_HEADER);
+    uint8_t bytes[EXTENDED_HEADER_LENGTH];
+    size_t length = encodeExtendedHeader(bytes, nameLengthBitSize, valueLengthBitSize, flags);
 
-    for(uint8_t i = 7u; i >= 4u; --i, nameLengthBitSize >>= 1)
-        if(*lengthBitSizes.get() & (1u << i))
-            break;
+    output.write((char*) (&bytes[0]), length);
+    BDP_COUNT(STREAM_WRITES, 1u);
 
-    if(nameLengthBitSize == 0)
-        throw std::invalid_argument("input: Invalid package header");
+    return new BDP::Header(nameLengthBitSize, valueLengthBitSize, flags);
+}
+BDP::Header* BDP::writeExtendedHeader(uint8_t* output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, uint8_t flags) {
+    BDP_TIME(WRITE_HEADER);
+    encodeExtendedHeader(output, nameLengthBitSize, valueLengthBitSize, flags);
 
-    for(uint8_t i = 3u; i >= 0u; --i, valueLengthBitSize >>= 1)
-        if (*lengthBitSizes.get() & (1u << i))
-            break;
+    return new BDP::Header(nameLengthBitSize, valueLengthBitSize, flags);
+}
 
-    if(valueLengthBitSize == 0)
-        throw std::invalid_argument("input: Invalid package header");
+BDP::Header* BDP::readExtendedHeader(std::istream& input) {
+    BDP_TIME(READ_HEADER);
+    uint8_t bytes[EXTENDED_HEADER_LENGTH];
 
-    checkByteSize(nameLengthBitSize / 8);
-    checkByteSize(valueLengthBitSize / 8);
+    input.read((char*) (&bytes[0]), HEADER_LENGTH);
+    BDP_COUNT(STREAM_READS, 1u);
 
-    return new BDP::Header(nameLengthBitSize, valueLengthBitSize);
+    if(static_cast<size_t>(input.gcount()) != HEADER_LENGTH)
+        throw std::invalid_argument("input");
+
+    // Only the extended header has the flags byte.
+    if(memcmp(bytes, EXTENDED_MAGIC_VALUE, MAGIC_VALUE_LENGTH) == 0) {
+        input.read((char*) (&bytes[HEADER_LENGTH]), 1u);
+        BDP_COUNT(STREAM_READS, 1u);
+
+        if(input.gcount() != 1)
+            throw std::invalid_argument("input");
+    }
+
+    return new BDP::Header(decodeExtendedHeader(bytes));
+}
+BDP::Header* BDP::readExtendedHeader(const uint8_t* input) {
+    BDP_TIME(READ_HEADER);
+    return new BDP::Header(decodeExtendedHeader(input));
 }
 
 size_t BDP::readName(const BDP::Header* header, std::istream& input, uint8_t* name, size_t* nameLength) {
@@ -349,18 +608,28 @@ size_t BDP::readName(const BDP::Header* header, const uint8_t* input, std::ostre
 }
 
 size_t BDP::readValue(const BDP::Header* header, std::istream& input, uint8_t* value, size_t* valueLength) {
+    BDP_COUNT(PAIRS_READ, 1u);
+
     return readData(header->VALUE_LENGTH_BYTE_SIZE, input, value, valueLength);
 }
 size_t BDP::readValue(const BDP::Header* header, const uint8_t* input, uint8_t* value, size_t* valueLength) {
+    BDP_COUNT(PAIRS_READ, 1u);
+
     return readData(header->VALUE_LENGTH_BYTE_SIZE, input, value, valueLength);
 }
 size_t BDP::readValue(const BDP::Header* header, std::istream& input, std::ostream& value) {
+    BDP_COUNT(PAIRS_READ, 1u);
+
     return readData(header->VALUE_LENGTH_BYTE_SIZE, input, value, DEFAULT_BUFFER_SIZE);
 }
 size_t BDP::readValue(const BDP::Header* header, std::istream& input, std::ostream& value, size_t bufferSize) {
+    BDP_COUNT(PAIRS_READ, 1u);
+
     return readData(header->VALUE_LENGTH_BYTE_SIZE, input, value, bufferSize);
 }
 size_t BDP::readValue(const BDP::Header* header, const uint8_t* input, std::ostream& value, size_t* valueLength) {
+    BDP_COUNT(PAIRS_READ, 1u);
+
     return readData(header->VALUE_LENGTH_BYTE_SIZE, input, value, valueLength);
 }
 
@@ -410,6 +679,7 @@ size_t BDP::readPair(const BDP::Header* header, std::istream& input, std::ostrea
 }
 
 size_t BDP::readData(uint8_t lengthByteSize, std::istream& input, uint8_t*& output, size_t* outputLength) {
+    BDP_TIME(READ_DATA);
     checkByteSize(lengthByteSize);
 
     size_t length = 0u;
@@ -417,32 +687,45 @@ size_t BDP::readData(uint8_t lengthByteSize, std::istream& input, uint8_t*& outp
     if(isLittleEndian()) {
         input.read(reinterpret_cast<char*>(&length), lengthByteSize);
     } else {
-        auto outputLengthBytes = std::make_unique<uint8_t[]>(lengthByteSize);
-        input.read((char*) outputLengthBytes.get(), lengthByteSize);
+        uint8_t outputLengthBytes[sizeof(size_t)];
+        input.read((char*) (&outputLengthBytes[0]), lengthByteSize);
 
-        reversedBytesToValue(length, outputLengthBytes.get(), lengthByteSize);
+        reversedBytesToValue(length, outputLengthBytes, lengthByteSize);
     }
 
     input.read((char*) (&output[0]), length);
 
+    BDP_COUNT(STREAM_READS, 2u);
+    BDP_COUNT(BYTES_READ, lengthByteSize + length);
+
     if(outputLength != nullptr)
         *outputLength = length;
 
     return lengthByteSize + length;
 }
 size_t BDP::readData(uint8_t lengthByteSize, const uint8_t* input, uint8_t*& output, size_t* outputLength) {
+    BDP_TIME(READ_DATA);
     size_t length = 0u;
 
     bytesToLength(length, input, lengthByteSize);
 
     memcpy(output, input + lengthByteSize, static_cast<size_t>(length));
 
+    BDP_COUNT(BYTES_READ, lengthByteSize + length);
+
     if(outputLength != nullptr)
         *outputLength = length;
 
     return lengthByteSize + length;
 }
 size_t BDP::readData(uint8_t lengthByteSize, std::istream& input, std::ostream& output, size_t bufferSize) {
+    auto buffer = std::make_unique<uint8_t[]>(bufferSize);
+    BDP_COUNT(BUFFER_ALLOCATIONS, 1u);
+
+    return readData(lengthByteSize, input, output, buffer.get(), bufferSize);
+}
+size_t BDP::readData(uint8_t lengthByteSize, std::istream& input, std::ostream& output, uint8_t* buffer, size_t bufferSize) {
+    BDP_TIME(READ_DATA);
     checkByteSize(lengthByteSize);
 
     size_t length = 0u;
@@ -450,37 +733,128 @@ size_t BDP::readData(uint8_t lengthByteSize, std::istream& input, std::ostream&
     if(isLittleEndian()) {
         input.read(reinterpret_cast<char*>(&length), lengthByteSize);
     } else {
-        auto outputLengthBytes = std::make_unique<uint8_t[]>(lengthByteSize);
-        input.read((char*) outputLengthBytes.get(), lengthByteSize);
+        uint8_t outputLengthBytes[sizeof(size_t)];
+        input.read((char*) (&outputLengthBytes[0]), lengthByteSize);
 
-        reversedBytesToValue(length, outputLengthBytes.get(), lengthByteSize);
+        reversedBytesToValue(length, outputLengthBytes, lengthByteSize);
     }
 
-    auto buffer = std::make_unique<char[]>(static_cast<size_t>(bufferSize));
+    size_t remaining = length;
     size_t nextLength;
 
-    while(length > 0u && !input.eof()) {
-        nextLength = length < bufferSize ? length : bufferSize;
-        input.read(buffer.get(), nextLength);
-        output.write(buffer.get(), input.gcount());
-        length -= static_cast<size_t>(input.gcount());
+    while(remaining > 0u && !input.eof()) {
+        nextLength = remaining < bufferSize ? remaining : bufferSize;
+        input.read(reinterpret_cast<char*>(buffer), nextLength);
+        output.write(reinterpret_cast<char*>(buffer), input.gcount());
+        remaining -= static_cast<size_t>(input.gcount());
+
+        BDP_COUNT(STREAM_READS, 1u);
+        BDP_COUNT(STREAM_WRITES, 1u);
+        BDP_COUNT(BYTES_READ, input.gcount());
     }
 
+    BDP_COUNT(STREAM_READS, 1u);
+    BDP_COUNT(BYTES_READ, lengthByteSize);
+
     return lengthByteSize + length;
 }
 size_t BDP::readData(uint8_t lengthByteSize, const uint8_t* input, std::ostream& output, size_t* outputLength) {
+    BDP_TIME(READ_DATA);
     size_t length = 0u;
 
     bytesToLength(length, input, lengthByteSize);
 
     output.write((char*) (input + lengthByteSize), length);
 
+    BDP_COUNT(STREAM_WRITES, 1u);
+    BDP_COUNT(BYTES_READ, lengthByteSize + length);
+
     if(outputLength != nullptr)
         *outputLength = length;
 
     return lengthByteSize + length;
 }
 
+size_t BDP::skipName(const BDP::Header* header, std::istream& input) {
+    return skipData(header->NAME_LENGTH_BYTE_SIZE, input);
+}
+size_t BDP::skipName(const BDP::Header* header, const uint8_t* input) {
+    return skipData(header->NAME_LENGTH_BYTE_SIZE, input);
+}
+
+size_t BDP::skipValue(const BDP::Header* header, std::istream& input) {
+    return skipData(header->VALUE_LENGTH_BYTE_SIZE, input);
+}
+size_t BDP::skipValue(const BDP::Header* header, const uint8_t* input) {
+    return skipData(header->VALUE_LENGTH_BYTE_SIZE, input);
+}
+
+size_t BDP::skipPair(const BDP::Header* header, std::istream& input) {
+    size_t count = skipName(header, input);
+    return count + skipValue(header, input);
+}
+size_t BDP::skipPair(const BDP::Header* header, const uint8_t* input) {
+    size_t count = skipName(header, input);
+    return count + skipValue(header, input + count);
+}
+
+size_t BDP::skipData(uint8_t lengthByteSize, std::istream& input) {
+    BDP_TIME(SKIP_DATA);
+    checkByteSize(lengthByteSize);
+
+    uint8_t lengthBytes[sizeof(size_t)];
+    size_t length = 0u;
+
+    input.read((char*) (&lengthBytes[0]), lengthByteSize);
+
+    if(static_cast<size_t>(input.gcount()) != lengthByteSize)
+        throw std::runtime_error("input: Truncated data length");
+
+    bytesToLength(length, lengthBytes, lengthByteSize);
+
+    if(length == 0u)
+        return lengthByteSize;
+
+    // Seeking past the end succeeds on files, so the seek stops before the last byte, which is then read
+    // to check that the data is complete.
+    input.seekg(static_cast<std::streamoff>(length - 1u), std::ios::cur);
+
+    if(!input.fail()) {
+        BDP_COUNT(SEEKS, 1u);
+
+        if(input.get() == std::char_traits<char>::eof())
+            throw std::runtime_error("input: Truncated data");
+    } else {
+        // The stream can't seek (e.g. a pipe or socket), so the data has to be read and discarded.
+        input.clear();
+
+        char buffer[4096];
+        size_t remaining = length;
+        size_t nextLength;
+
+        while(remaining > 0u) {
+            nextLength = remaining < sizeof(buffer) ? remaining : sizeof(buffer);
+            input.read(buffer, nextLength);
+
+            if(input.gcount() == 0)
+                throw std::runtime_error("input: Truncated data");
+
+            remaining -= static_cast<size_t>(input.gcount());
+
+            BDP_COUNT(STREAM_READS, 1u);
+        }
+    }
+
+    return lengthByteSize + length;
+}
+size_t BDP::skipData(uint8_t lengthByteSize, const uint8_t* input) {
+    size_t length = 0u;
+
+    bytesToLength(length, input, lengthByteSize);
+
+    return lengthByteSize + length;
+}
+
 size_t BDP::getMaxLength(uint8_t lengthBitSize) {
     if(lengthBitSize == 8u)
         return (uint8_t) - 1;
@@ -535,23 +909,38 @@ void BDP::reversedBytesToValue(size_t& destination, const uint8_t* source, uint8
 }
 
 // The most common cases are 4 and 1, so order the if statements in their favor.
+// The byte arrays aren't necessarily aligned, so memcpy is used instead of pointer casts.
 void BDP::valueToBytes(uint8_t* destination, size_t source, uint8_t count) {
-    if(count == 4u)
-        *reinterpret_cast<uint32_t*>(destination) = *reinterpret_cast<uint32_t*>(&source);
-    else if(count == 1u)
-        *destination = *reinterpret_cast<uint8_t*>(&source);
-    else if(count == 8u)
-        *reinterpret_cast<uint64_t*>(destination) = source;
-    else *reinterpret_cast<uint16_t*>(destination) = *reinterpret_cast<uint16_t*>(&source);
+    if(count == 4u) {
+        uint32_t value = static_cast<uint32_t>(source);
+        memcpy(destination, &value, 4u);
+    } else if(count == 1u) {
+        *destination = static_cast<uint8_t>(source);
+    } else if(count == 8u) {
+        uint64_t value = source;
+        memcpy(destination, &value, 8u);
+    } else {
+        uint16_t value = static_cast<uint16_t>(source);
+        memcpy(destination, &value, 2u);
+    }
 }
 
 // The most common cases are 4 and 1, so order the if statements in their favor.
+// The byte arrays aren't necessarily aligned, so memcpy is used instead of pointer casts.
 void BDP::bytesToValue(size_t& destination, const uint8_t* source, uint8_t count) {
-    if(count == 4u)
-        destination = *reinterpret_cast<const uint32_t*>(source);
-    else if(count == 1u)
+    if(count == 4u) {
+        uint32_t value;
+        memcpy(&value, source, 4u);
+        destination = value;
+    } else if(count == 1u) {
         destination = *source;
-    else if(count == 8u)
-        destination = *reinterpret_cast<const uint64_t*>(source);
-    else destination = *reinterpret_cast<const uint16_t*>(source);
-}
\ No newline at end of file
+    } else if(count == 8u) {
+        uint64_t value;
+        memcpy(&value, source, 8u);
+        destination = static_cast<size_t>(value);
+    } else {
+        uint16_t value;
+        memcpy(&value, source, 2u);
+        destination = value;
+    }
+}
@@ -29,8 +29,21 @@
 #include <ostream>
 
 namespace BDP {
+    /// The length of a package header, including the magic value.
+    const size_t HEADER_LENGTH = 4u;
+    /// The length of an extended package header, which also contains the flags.
+    const size_t EXTENDED_HEADER_LENGTH = 5u;
+
+    /// The values of the package are stored in compressed blocks.
+    const uint8_t HEADER_FLAG_COMPRESSED = 0x01u;
+    /// Every pair is followed by a CRC32C checksum of its bytes.
+    const uint8_t HEADER_FLAG_CHECKSUMMED = 0x02u;
+    /// Repeated names refer to an entry of a dictionary which is built from the earlier pairs.
+    const uint8_t HEADER_FLAG_NAME_DICTIONARY = 0x04u;
+
     struct Header {
         Header(uint8_t nlbs, uint8_t vlbs);
+        Header(uint8_t nlbs, uint8_t vlbs, uint8_t flags);
 
         const size_t NAME_MAX_LENGTH;
         const size_t VALUE_MAX_LENGTH;
@@ -40,8 +53,17 @@ namespace BDP {
 
         const uint8_t NAME_LENGTH_BYTE_SIZE;
         const uint8_t VALUE_LENGTH_BYTE_SIZE;
+
+        const uint8_t FLAGS;
     };
 
+    void encodeHeader(uint8_t* output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize);
+    Header decodeHeader(const uint8_t* input);
+
+    size_t encodeExtendedHeader(uint8_t* output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, uint8_t flags);
+    Header decodeExtendedHeader(const uint8_t* input);
+    size_t getHeaderLength(const Header* header);
+
     Header* writeHeader(std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize);
     Header* writeHeader(uint8_t* output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize);
 
@@ -59,6 +81,16 @@ namespace BDP {
     size_t writeValue(const Header* header, uint8_t* output, std::istream& value);
     size_t writeValue(const Header* header, uint8_t* output, std::istream& value, size_t bufferSize);
 
+    size_t writeSizedName(const Header* header, std::ostream& output, std::istream& name, size_t nameLength);
+    size_t writeSizedName(const Header* header, std::ostream& output, std::istream& name, size_t nameLength, size_t bufferSize);
+    size_t writeSpooledName(const Header* header, std::ostream& output, std::istream& name);
+    size_t writeSpooledName(const Header* header, std::ostream& output, std::istream& name, size_t bufferSize, size_t spoolSize);
+
+    size_t writeSizedValue(const Header* header, std::ostream& output, std::istream& value, size_t valueLength);
+    size_t writeSizedValue(const Header* header, std::ostream& output, std::istream& value, size_t valueLength, size_t bufferSize);
+    size_t writeSpooledValue(const Header* header, std::ostream& output, std::istream& value);
+    size_t writeSpooledValue(const Header* header, std::ostream& output, std::istream& value, size_t bufferSize, size_t spoolSize);
+
     size_t writePair(const Header* header, std::ostream& output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
     size_t writePair(const Header* header, uint8_t* output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
     size_t writePair(const Header* header, std::ostream& output, const uint8_t* name, size_t nameLength, std::istream& value);
@@ -77,11 +109,22 @@ namespace BDP {
     size_t writeData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, const uint8_t *data, size_t dataLength);
     size_t writeData(size_t maxLength, uint8_t lengthByteSize, uint8_t* output, const uint8_t *data, size_t dataLength);
     size_t writeData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, std::istream& data, size_t bufferSize);
+    size_t writeData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, std::istream& data, uint8_t* buffer, size_t bufferSize);
     size_t writeData(size_t maxLength, uint8_t lengthByteSize, uint8_t* output, std::istream& data, size_t bufferSize);
+    size_t writeSizedData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, std::istream& data, size_t dataLength, size_t bufferSize);
+    size_t writeSizedData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, std::istream& data, size_t dataLength, uint8_t* buffer, size_t bufferSize);
+    size_t writeSpooledData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, std::istream& data, size_t bufferSize, size_t spoolSize);
+    size_t writeSpooledData(size_t maxLength, uint8_t lengthByteSize, std::ostream& output, std::istream& data, uint8_t* buffer, size_t bufferSize, size_t spoolSize);
 
     Header* readHeader(std::istream& input);
     Header* readHeader(const uint8_t* input);
 
+    Header* writeExtendedHeader(std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, uint8_t flags);
+    Header* writeExtendedHeader(uint8_t* output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, uint8_t flags);
+
+    Header* readExtendedHeader(std::istream& input);
+    Header* readExtendedHeader(const uint8_t* input);
+
     size_t readName(const Header* header, std::istream& input, uint8_t* name, size_t* nameLength);
     size_t readName(const Header* header, const uint8_t* input, uint8_t* name, size_t* nameLength);
     size_t readName(const Header* header, std::istream& input, std::ostream& name);
@@ -109,8 +152,21 @@ namespace BDP {
     size_t readData(uint8_t lengthByteSize, std::istream& input, uint8_t *&output, size_t* outputLength);
     size_t readData(uint8_t lengthByteSize, const uint8_t* input, uint8_t *&output, size_t* outputLength);
     size_t readData(uint8_t lengthByteSize, std::istream& input, std::ostream& output, size_t bufferSize);
+    size_t readData(uint8_t lengthByteSize, std::istream& input, std::ostream& output, uint8_t* buffer, size_t bufferSize);
     size_t readData(uint8_t lengthByteSize, const uint8_t* input, std::ostream& output,size_t* outputLength);
 
+    size_t skipName(const Header* header, std::istream& input);
+    size_t skipName(const Header* header, const uint8_t* input);
+
+    size_t skipValue(const Header* header, std::istream& input);
+    size_t skipValue(const Header* header, const uint8_t* input);
+
+    size_t skipPair(const Header* header, std::istream& input);
+    size_t skipPair(const Header* header, const uint8_t* input);
+
+    size_t skipData(uint8_t lengthByteSize, std::istream& input);
+    size_t skipData(uint8_t lengthByteSize, const uint8_t* input);
+
     size_t getMaxLength(uint8_t lengthBitSize);
 
     bool isLittleEndian();
@@ -0,0 +1,245 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "builder.hxx"
+#include "codec.hxx"
+#include "metrics.hxx"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <climits>
+    #include <system_error>
+    #include <sys/uio.h>
+    #include <unistd.h>
+
+    /// The most buffers passed to one writev call.
+    #ifdef IOV_MAX
+        const size_t BUILDER_MAX_IOVECS = IOV_MAX;
+    #else
+        const size_t BUILDER_MAX_IOVECS = 1024u;
+    #endif
+#endif
+
+BDP::Header createBuilderHeader(uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
+    uint8_t bytes[BDP::HEADER_LENGTH];
+    BDP::encodeHeader(bytes, nameLengthBitSize, valueLengthBitSize);
+
+    return BDP::decodeHeader(bytes);
+}
+
+BDP::PackageSegment::PackageSegment(const Header* header, PairEncoder encodePair, size_t blockSize)
+    : header(header), encodePair(encodePair), blocks(), blockSize(blockSize), length(0u), pairCount(0u) { }
+
+size_t BDP::PackageSegment::writePair(const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+    if(nameLength > header->NAME_MAX_LENGTH)
+        throw std::invalid_argument("nameLength");
+    if(valueLength > header->VALUE_MAX_LENGTH)
+        throw std::invalid_argument("valueLength");
+
+    size_t pairLength = header->NAME_LENGTH_BYTE_SIZE + nameLength + header->VALUE_LENGTH_BYTE_SIZE + valueLength;
+
+    // Segments are owned by one thread each, so nothing here is shared; the metrics are
+    // counted when the package is written, to keep the atomic counters out of this path.
+    encodePair(allocate(pairLength), name, nameLength, value, valueLength);
+
+    length += pairLength;
+    ++pairCount;
+
+    return pairLength;
+}
+
+// Pairs are never split across blocks, and full blocks are never reallocated, so the
+// encoded bytes are written exactly once.
+uint8_t* BDP::PackageSegment::allocate(size_t pairLength) {
+    if(!blocks.empty()) {
+        Block& last = blocks.back();
+
+        if(pairLength <= last.size - last.used) {
+            uint8_t* position = last.data.get() + last.used;
+            last.used += pairLength;
+
+            return position;
+        }
+    }
+
+    size_t size = pairLength > blockSize ? pairLength : blockSize;
+
+    blocks.push_back({ std::make_unique<uint8_t[]>(size), size, pairLength });
+    return blocks.back().data.get();
+}
+
+BDP::PackageBuilder::PackageBuilder(uint8_t nameLengthBitSize, uint8_t valueLengthBitSize)
+    : PackageBuilder(nameLengthBitSize, valueLengthBitSize, DEFAULT_SEGMENT_BLOCK_SIZE) { }
+
+BDP::PackageBuilder::PackageBuilder(uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, size_t blockSize)
+    : header(createBuilderHeader(nameLengthBitSize, valueLengthBitSize)),
+      encodePair(nullptr),
+      blockSize(blockSize),
+      segments(),
+      mutex() {
+    if(blockSize == 0u)
+        throw std::invalid_argument("blockSize");
+
+    encodePair = dispatch(&header, [](auto codec) -> PackageSegment::PairEncoder {
+        return &decltype(codec)::writePair;
+    });
+}
+
+// Only the segment list is locked; a thread creates its segment once, and then writes to it without locks.
+BDP::PackageSegment& BDP::PackageBuilder::createSegment() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    segments.push_back(std::unique_ptr<PackageSegment>(new PackageSegment(&header, encodePair, blockSize)));
+    return *segments.back();
+}
+
+size_t BDP::PackageBuilder::getLength() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t length = getHeaderLength(&header);
+
+    for(const std::unique_ptr<PackageSegment>& segment : segments)
+        length += segment->length;
+
+    return length;
+}
+
+size_t BDP::PackageBuilder::getPairCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t count = 0u;
+
+    for(const std::unique_ptr<PackageSegment>& segment : segments)
+        count += segment->pairCount;
+
+    return count;
+}
+
+// The format has no state which spans pairs, so the package is the header followed by
+// the segments, in the order in which they were created.
+size_t BDP::PackageBuilder::writeTo(uint8_t* output) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    encodeHeader(output, header.NAME_LENGTH_BIT_SIZE, header.VALUE_LENGTH_BIT_SIZE);
+    size_t count = HEADER_LENGTH;
+
+    for(const std::unique_ptr<PackageSegment>& segment : segments) {
+        for(const PackageSegment::Block& block : segment->blocks) {
+            memcpy(output + count, block.data.get(), block.used);
+            count += block.used;
+        }
+
+        BDP_COUNT(PAIRS_WRITTEN, segment->pairCount);
+    }
+
+    BDP_COUNT(BYTES_WRITTEN, count);
+
+    return count;
+}
+
+size_t BDP::PackageBuilder::writeTo(std::ostream& output) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint8_t headerBytes[HEADER_LENGTH];
+    encodeHeader(headerBytes, header.NAME_LENGTH_BIT_SIZE, header.VALUE_LENGTH_BIT_SIZE);
+    size_t count = HEADER_LENGTH;
+
+    output.write(reinterpret_cast<const char*>(headerBytes), count);
+    BDP_COUNT(STREAM_WRITES, 1u);
+
+    for(const std::unique_ptr<PackageSegment>& segment : segments) {
+        for(const PackageSegment::Block& block : segment->blocks) {
+            output.write(reinterpret_cast<const char*>(block.data.get()), block.used);
+            count += block.used;
+
+            BDP_COUNT(STREAM_WRITES, 1u);
+        }
+
+        BDP_COUNT(PAIRS_WRITTEN, segment->pairCount);
+    }
+
+    BDP_COUNT(BYTES_WRITTEN, count);
+
+    return count;
+}
+
+// The blocks are handed to the kernel as they are, with as few writev calls as possible.
+size_t BDP::PackageBuilder::writeTo(int output) const {
+#ifdef _WIN32
+    (void) output;
+    throw std::runtime_error("Writing a package builder to a file descriptor is not supported on this platform");
+#else
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint8_t headerBytes[HEADER_LENGTH];
+    encodeHeader(headerBytes, header.NAME_LENGTH_BIT_SIZE, header.VALUE_LENGTH_BIT_SIZE);
+
+    std::vector<iovec> buffers;
+    buffers.push_back({ headerBytes, HEADER_LENGTH });
+
+    for(const std::unique_ptr<PackageSegment>& segment : segments) {
+        for(const PackageSegment::Block& block : segment->blocks)
+            buffers.push_back({ block.data.get(), block.used });
+
+        BDP_COUNT(PAIRS_WRITTEN, segment->pairCount);
+    }
+
+    size_t count = 0u;
+    size_t index = 0u;
+
+    while(index < buffers.size()) {
+        size_t batch = buffers.size() - index < BUILDER_MAX_IOVECS ? buffers.size() - index : BUILDER_MAX_IOVECS;
+        ssize_t result = writev(output, buffers.data() + index, static_cast<int>(batch));
+
+        if(result < 0) {
+            if(errno == EINTR)
+                continue;
+
+            throw std::system_error(errno, std::generic_category(), "output");
+        }
+
+        BDP_COUNT(STREAM_WRITES, 1u);
+
+        size_t written = static_cast<size_t>(result);
+        count += written;
+
+        // Skip the buffers which were written, and resume a partially written one.
+        while(written > 0u && written >= buffers[index].iov_len)
+            written -= buffers[index++].iov_len;
+
+        if(written > 0u) {
+            buffers[index].iov_base = static_cast<uint8_t*>(buffers[index].iov_base) + written;
+            buffers[index].iov_len -= written;
+        }
+
+        while(index < buffers.size() && buffers[index].iov_len == 0u)
+            ++index;
+    }
+
+    BDP_COUNT(BYTES_WRITTEN, count);
+
+    return count;
+#endif
+}
@@ -0,0 +1,102 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BDP_BUILDER_HXX_INCLUDED
+#define BDP_BUILDER_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace BDP {
+    /// The default size of the blocks in which segments store their pairs.
+    const size_t DEFAULT_SEGMENT_BLOCK_SIZE = 1048576u;
+
+    class PackageBuilder;
+
+    class PackageSegment {
+    public:
+        PackageSegment(const PackageSegment&) = delete;
+        PackageSegment& operator=(const PackageSegment&) = delete;
+
+        size_t writePair(const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
+
+        size_t getLength() const { return length; }
+        size_t getPairCount() const { return pairCount; }
+
+    private:
+        friend class PackageBuilder;
+
+        using PairEncoder = size_t (*)(uint8_t*, const uint8_t*, size_t, const uint8_t*, size_t);
+
+        struct Block {
+            std::unique_ptr<uint8_t[]> data;
+            size_t size;
+            size_t used;
+        };
+
+        PackageSegment(const Header* header, PairEncoder encodePair, size_t blockSize);
+
+        uint8_t* allocate(size_t length);
+
+        const Header* header;
+        PairEncoder encodePair;
+
+        std::vector<Block> blocks;
+        size_t blockSize;
+
+        size_t length;
+        size_t pairCount;
+    };
+
+    class PackageBuilder {
+    public:
+        PackageBuilder(uint8_t nameLengthBitSize, uint8_t valueLengthBitSize);
+        PackageBuilder(uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, size_t blockSize);
+
+        PackageBuilder(const PackageBuilder&) = delete;
+        PackageBuilder& operator=(const PackageBuilder&) = delete;
+
+        PackageSegment& createSegment();
+
+        const Header& getHeader() const { return header; }
+        size_t getLength() const;
+        size_t getPairCount() const;
+
+        size_t writeTo(uint8_t* output) const;
+        size_t writeTo(std::ostream& output) const;
+        size_t writeTo(int output) const;
+
+    private:
+        Header header;
+        PackageSegment::PairEncoder encodePair;
+        size_t blockSize;
+
+        std::vector<std::unique_ptr<PackageSegment>> segments;
+        mutable std::mutex mutex;
+    };
+}
+
+#endif
@@ -0,0 +1,463 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "checksum.hxx"
+#include "dictionary.hxx"
+#include "metrics.hxx"
+
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define BDP_CRC32C_X86
+    #include <nmmintrin.h>
+
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define BDP_CRC32C_TARGET
+    #else
+        #define BDP_CRC32C_TARGET __attribute__((target("sse4.2")))
+    #endif
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+    #define BDP_CRC32C_ARM
+    #include <arm_acle.h>
+
+    #define BDP_CRC32C_TARGET
+#endif
+
+/// The reflected CRC32C (Castagnoli) polynomial.
+const uint32_t CRC32C_POLYNOMIAL = 0x82F63B78u;
+
+// The accelerated version computes three independent CRCs over adjacent blocks, which hides the
+// latency of the CRC instruction, and then combines them by shifting the first ones over the others.
+const size_t CRC32C_LONG_BLOCK = 8192u;
+const size_t CRC32C_SHORT_BLOCK = 256u;
+
+uint32_t multiplyCrc32cMatrix(const uint32_t* matrix, uint32_t vector) {
+    uint32_t sum = 0u;
+
+    for(; vector != 0u; vector >>= 1u, ++matrix) {
+        if(vector & 1u)
+            sum ^= *matrix;
+    }
+
+    return sum;
+}
+
+void squareCrc32cMatrix(uint32_t* square, const uint32_t* matrix) {
+    for(uint8_t i = 0u; i < 32u; ++i)
+        square[i] = multiplyCrc32cMatrix(matrix, matrix[i]);
+}
+
+struct Crc32cTables {
+    Crc32cTables();
+
+    // Slicing-by-8 tables, for the portable version.
+    uint32_t slices[8][256];
+
+    // Tables which shift a CRC over a long or short block of zeros.
+    uint32_t longShift[4][256];
+    uint32_t shortShift[4][256];
+};
+
+void buildCrc32cShift(uint32_t shift[4][256], size_t length) {
+    uint32_t odd[32];
+    uint32_t even[32];
+
+    // Start with the operator for one zero bit, and square it until it applies length zero bytes.
+    odd[0] = CRC32C_POLYNOMIAL;
+    for(uint8_t i = 1u; i < 32u; ++i)
+        odd[i] = 1u << (i - 1u);
+
+    squareCrc32cMatrix(even, odd);
+    squareCrc32cMatrix(odd, even);
+
+    uint32_t* result = even;
+
+    while(true) {
+        squareCrc32cMatrix(even, odd);
+        length >>= 1u;
+        result = even;
+
+        if(length == 0u)
+            break;
+
+        squareCrc32cMatrix(odd, even);
+        length >>= 1u;
+        result = odd;
+
+        if(length == 0u)
+            break;
+    }
+
+    for(uint32_t i = 0u; i < 256u; ++i) {
+        shift[0][i] = multiplyCrc32cMatrix(result, i);
+        shift[1][i] = multiplyCrc32cMatrix(result, i << 8u);
+        shift[2][i] = multiplyCrc32cMatrix(result, i << 16u);
+        shift[3][i] = multiplyCrc32cMatrix(result, i << 24u);
+    }
+}
+
+Crc32cTables::Crc32cTables() {
+    for(uint32_t i = 0u; i < 256u; ++i) {
+        uint32_t crc = i;
+
+        for(uint8_t bit = 0u; bit < 8u; ++bit)
+            crc = (crc & 1u) ? (crc >> 1u) ^ CRC32C_POLYNOMIAL : crc >> 1u;
+
+        slices[0][i] = crc;
+    }
+
+    for(uint32_t i = 0u; i < 256u; ++i) {
+        for(uint8_t slice = 1u; slice < 8u; ++slice)
+            slices[slice][i] = (slices[slice - 1u][i] >> 8u) ^ slices[0][slices[slice - 1u][i] & 0xFFu];
+    }
+
+    buildCrc32cShift(longShift, CRC32C_LONG_BLOCK);
+    buildCrc32cShift(shortShift, CRC32C_SHORT_BLOCK);
+}
+
+const Crc32cTables CRC32C_TABLES;
+
+uint32_t shiftCrc32c(const uint32_t shift[4][256], uint32_t crc) {
+    return shift[0][crc & 0xFFu] ^ shift[1][(crc >> 8u) & 0xFFu] ^ shift[2][(crc >> 16u) & 0xFFu] ^ shift[3][crc >> 24u];
+}
+
+uint32_t readCrc32cWord(const uint8_t* data) {
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8u) |
+           (static_cast<uint32_t>(data[2]) << 16u) | (static_cast<uint32_t>(data[3]) << 24u);
+}
+
+uint32_t computeSoftwareCrc32c(uint32_t crc, const uint8_t* data, size_t length) {
+    const uint32_t (*slices)[256] = CRC32C_TABLES.slices;
+
+    for(; length >= 8u; data += 8u, length -= 8u) {
+        uint32_t low = crc ^ readCrc32cWord(data);
+        uint32_t high = readCrc32cWord(data + 4u);
+
+        crc = slices[7][low & 0xFFu] ^ slices[6][(low >> 8u) & 0xFFu] ^ slices[5][(low >> 16u) & 0xFFu] ^ slices[4][low >> 24u] ^
+              slices[3][high & 0xFFu] ^ slices[2][(high >> 8u) & 0xFFu] ^ slices[1][(high >> 16u) & 0xFFu] ^ slices[0][high >> 24u];
+    }
+
+    while(length--)
+        crc = (crc >> 8u) ^ slices[0][(crc ^ *data++) & 0xFFu];
+
+    return crc;
+}
+
+#ifdef BDP_CRC32C_TARGET
+BDP_CRC32C_TARGET inline uint32_t stepCrc32c(uint32_t crc, const uint8_t* data) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+
+#ifdef BDP_CRC32C_X86
+    return static_cast<uint32_t>(_mm_crc32_u64(crc, word));
+#else
+    return __crc32cd(crc, word);
+#endif
+}
+
+BDP_CRC32C_TARGET inline uint32_t stepCrc32c(uint32_t crc, uint8_t data) {
+#ifdef BDP_CRC32C_X86
+    return _mm_crc32_u8(crc, data);
+#else
+    return __crc32cb(crc, data);
+#endif
+}
+
+BDP_CRC32C_TARGET uint32_t interleaveCrc32c(uint32_t crc, const uint8_t*& data, size_t& length, size_t block, const uint32_t shift[4][256]) {
+    while(length >= 3u * block) {
+        uint32_t crc1 = 0u;
+        uint32_t crc2 = 0u;
+        const uint8_t* end = data + block;
+
+        do {
+            crc = stepCrc32c(crc, data);
+            crc1 = stepCrc32c(crc1, data + block);
+            crc2 = stepCrc32c(crc2, data + 2u * block);
+            data += 8u;
+        } while(data < end);
+
+        crc = shiftCrc32c(shift, crc) ^ crc1;
+        crc = shiftCrc32c(shift, crc) ^ crc2;
+
+        data += 2u * block;
+        length -= 3u * block;
+    }
+
+    return crc;
+}
+
+BDP_CRC32C_TARGET uint32_t computeHardwareCrc32c(uint32_t crc, const uint8_t* data, size_t length) {
+    while(length != 0u && (reinterpret_cast<uintptr_t>(data) & 7u) != 0u) {
+        crc = stepCrc32c(crc, *data++);
+        --length;
+    }
+
+    crc = interleaveCrc32c(crc, data, length, CRC32C_LONG_BLOCK, CRC32C_TABLES.longShift);
+    crc = interleaveCrc32c(crc, data, length, CRC32C_SHORT_BLOCK, CRC32C_TABLES.shortShift);
+
+    for(; length >= 8u; data += 8u, length -= 8u)
+        crc = stepCrc32c(crc, data);
+
+    while(length--)
+        crc = stepCrc32c(crc, *data++);
+
+    return crc;
+}
+#endif
+
+bool detectCrc32c() {
+#if defined(BDP_CRC32C_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+
+    return (info[2] & (1 << 20)) != 0;
+#elif defined(BDP_CRC32C_X86)
+    return __builtin_cpu_supports("sse4.2");
+#elif defined(BDP_CRC32C_ARM)
+    return true;
+#else
+    return false;
+#endif
+}
+
+const bool CRC32C_ACCELERATED = detectCrc32c();
+
+void checkChecksummedHeader(const BDP::Header* header) {
+    if((header->FLAGS & BDP::HEADER_FLAG_CHECKSUMMED) == 0u)
+        throw std::invalid_argument("header: The package is not checksummed");
+    if((header->FLAGS & BDP::HEADER_FLAG_NAME_DICTIONARY) != 0u)
+        throw std::invalid_argument("header: Dictionary packages must be read and written with a NameDictionary");
+}
+
+// The checksum covers the pair as it is stored, including the length bytes.
+uint32_t computePairChecksum(const BDP::Header* header, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+    uint8_t lengthBytes[sizeof(size_t)];
+
+    BDP::lengthToBytes(lengthBytes, nameLength, header->NAME_LENGTH_BYTE_SIZE);
+    uint32_t crc = BDP::crc32c(lengthBytes, header->NAME_LENGTH_BYTE_SIZE);
+    crc = BDP::crc32c(crc, name, nameLength);
+
+    BDP::lengthToBytes(lengthBytes, valueLength, header->VALUE_LENGTH_BYTE_SIZE);
+    crc = BDP::crc32c(crc, lengthBytes, header->VALUE_LENGTH_BYTE_SIZE);
+
+    return BDP::crc32c(crc, value, valueLength);
+}
+
+uint32_t BDP::crc32c(const uint8_t* data, size_t length) {
+    return crc32c(0u, data, length);
+}
+
+uint32_t BDP::crc32c(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+
+#ifdef BDP_CRC32C_TARGET
+    if(CRC32C_ACCELERATED)
+        return ~computeHardwareCrc32c(crc, data, length);
+#endif
+
+    return ~computeSoftwareCrc32c(crc, data, length);
+}
+
+bool BDP::isCrc32cAccelerated() {
+    return CRC32C_ACCELERATED;
+}
+
+size_t BDP::writeChecksummedPair(const BDP::Header* header, std::ostream& output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+    checkChecksummedHeader(header);
+
+    size_t count = writePair(header, output, name, nameLength, value, valueLength);
+
+    uint8_t checksum[CHECKSUM_LENGTH];
+    lengthToBytes(checksum, computePairChecksum(header, name, nameLength, value, valueLength), CHECKSUM_LENGTH);
+
+    output.write((char*) checksum, CHECKSUM_LENGTH);
+    BDP_COUNT(BYTES_WRITTEN, CHECKSUM_LENGTH);
+
+    return count + CHECKSUM_LENGTH;
+}
+size_t BDP::writeChecksummedPair(const BDP::Header* header, uint8_t* output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+    checkChecksummedHeader(header);
+
+    size_t count = writePair(header, output, name, nameLength, value, valueLength);
+
+    lengthToBytes(output + count, crc32c(output, count), CHECKSUM_LENGTH);
+    BDP_COUNT(BYTES_WRITTEN, CHECKSUM_LENGTH);
+
+    return count + CHECKSUM_LENGTH;
+}
+
+size_t BDP::readChecksummedPair(const BDP::Header* header, std::istream& input, uint8_t* name, size_t* nameLength, uint8_t* value, size_t* valueLength) {
+    checkChecksummedHeader(header);
+
+    size_t nameLengthValue = 0u;
+    size_t valueLengthValue = 0u;
+
+    size_t count = readName(header, input, name, &nameLengthValue);
+    count += readValue(header, input, value, &valueLengthValue);
+
+    uint8_t checksumBytes[CHECKSUM_LENGTH];
+    input.read((char*) checksumBytes, CHECKSUM_LENGTH);
+
+    if(static_cast<size_t>(input.gcount()) != CHECKSUM_LENGTH)
+        throw std::runtime_error("input: Truncated checksum");
+
+    BDP_COUNT(BYTES_READ, CHECKSUM_LENGTH);
+
+    size_t checksum = 0u;
+    bytesToLength(checksum, checksumBytes, CHECKSUM_LENGTH);
+
+    if(checksum != computePairChecksum(header, name, nameLengthValue, value, valueLengthValue))
+        throw std::runtime_error("input: Checksum mismatch");
+
+    if(nameLength != nullptr)
+        *nameLength = nameLengthValue;
+    if(valueLength != nullptr)
+        *valueLength = valueLengthValue;
+
+    return count + CHECKSUM_LENGTH;
+}
+size_t BDP::readChecksummedPair(const BDP::Header* header, const uint8_t* input, uint8_t* name, size_t* nameLength, uint8_t* value, size_t* valueLength) {
+    checkChecksummedHeader(header);
+
+    // The pair is verified before it is copied.
+    size_t pairLength = 0u;
+    size_t length = 0u;
+
+    bytesToLength(length, input, header->NAME_LENGTH_BYTE_SIZE);
+    pairLength += header->NAME_LENGTH_BYTE_SIZE + length;
+
+    bytesToLength(length, input + pairLength, header->VALUE_LENGTH_BYTE_SIZE);
+    pairLength += header->VALUE_LENGTH_BYTE_SIZE + length;
+
+    size_t checksum = 0u;
+    bytesToLength(checksum, input + pairLength, CHECKSUM_LENGTH);
+
+    if(checksum != crc32c(input, pairLength))
+        throw std::runtime_error("input: Checksum mismatch");
+
+    size_t nameLengthValue = 0u;
+    size_t count = readPair(header, input, name, &nameLengthValue, value, valueLength);
+
+    if(nameLength != nullptr)
+        *nameLength = nameLengthValue;
+
+    BDP_COUNT(BYTES_READ, CHECKSUM_LENGTH);
+
+    return count + CHECKSUM_LENGTH;
+}
+
+BDP::ValidationResult invalidPackage(size_t pairCount, const uint8_t* package, const uint8_t* position, const char* error) {
+    return { false, pairCount, static_cast<size_t>(position - package), error };
+}
+
+// Every length is checked against the remaining bytes before it is used, so the package is never read out of bounds.
+BDP::ValidationResult BDP::validatePackage(const uint8_t* package, size_t packageLength) {
+    const uint8_t* end = package + packageLength;
+
+    if(packageLength < HEADER_LENGTH || (memcmp(package, "BDX", 3u) == 0 && packageLength < EXTENDED_HEADER_LENGTH))
+        return invalidPackage(0u, package, package, "Truncated header");
+    if(memcmp(package, "BDP", 3u) != 0 && memcmp(package, "BDX", 3u) != 0)
+        return invalidPackage(0u, package, package, "Invalid magic value");
+
+    std::optional<Header> header;
+
+    try {
+        header.emplace(decodeExtendedHeader(package));
+    } catch(const std::exception&) {
+        return invalidPackage(0u, package, package, "Invalid header");
+    }
+
+    uint8_t nameLengthByteSize = header->NAME_LENGTH_BYTE_SIZE;
+    uint8_t valueLengthByteSize = header->VALUE_LENGTH_BYTE_SIZE;
+    bool checksummed = (header->FLAGS & HEADER_FLAG_CHECKSUMMED) != 0u;
+    bool dictionary = (header->FLAGS & HEADER_FLAG_NAME_DICTIONARY) != 0u;
+
+    const uint8_t* index = package + getHeaderLength(&*header);
+    size_t pairCount = 0u;
+    size_t entryCount = 0u;
+
+    while(index != end) {
+        const uint8_t* pair = index;
+        size_t length = 0u;
+        size_t marker = NAME_MARKER_LITERAL;
+
+        // Only the number of dictionary entries is tracked; a reference must be to an entry which was already defined.
+        if(dictionary) {
+            size_t markerLength = readNameMarker(index, static_cast<size_t>(end - index), &marker);
+
+            if(markerLength == 0u)
+                return invalidPackage(pairCount, package, pair, "Invalid name marker");
+
+            index += markerLength;
+
+            if(marker == NAME_MARKER_DEFINITION)
+                ++entryCount;
+            else if(marker >= NAME_MARKER_FIRST_REFERENCE && marker - NAME_MARKER_FIRST_REFERENCE >= entryCount)
+                return invalidPackage(pairCount, package, pair, "Invalid name reference");
+        }
+
+        if(marker < NAME_MARKER_FIRST_REFERENCE) {
+            if(static_cast<size_t>(end - index) < nameLengthByteSize)
+                return invalidPackage(pairCount, package, pair, "Truncated name length");
+
+            bytesToLength(length, index, nameLengthByteSize);
+            index += nameLengthByteSize;
+
+            if(static_cast<size_t>(end - index) < length)
+                return invalidPackage(pairCount, package, pair, "Truncated name");
+
+            index += length;
+        }
+
+        if(static_cast<size_t>(end - index) < valueLengthByteSize)
+            return invalidPackage(pairCount, package, pair, "Truncated value length");
+
+        bytesToLength(length, index, valueLengthByteSize);
+        index += valueLengthByteSize;
+
+        if(static_cast<size_t>(end - index) < length)
+            return invalidPackage(pairCount, package, pair, "Truncated value");
+
+        index += length;
+
+        if(checksummed) {
+            if(static_cast<size_t>(end - index) < CHECKSUM_LENGTH)
+                return invalidPackage(pairCount, package, pair, "Truncated checksum");
+
+            size_t checksum = 0u;
+            bytesToLength(checksum, index, CHECKSUM_LENGTH);
+
+            if(checksum != crc32c(pair, static_cast<size_t>(index - pair)))
+                return invalidPackage(pairCount, package, pair, "Checksum mismatch");
+
+            index += CHECKSUM_LENGTH;
+        }
+
+        ++pairCount;
+    }
+
+    return { true, pairCount, packageLength, nullptr };
+}
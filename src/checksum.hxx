@@ -0,0 +1,58 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_CHECKSUM_HXX_INCLUDED
+#define BDP_CHECKSUM_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace BDP {
+    /// The length of the checksum which follows every pair of a checksummed package.
+    const size_t CHECKSUM_LENGTH = 4u;
+
+    struct ValidationResult {
+        bool valid;
+        size_t pairCount;
+
+        size_t errorOffset;
+        const char* error;
+    };
+
+    uint32_t crc32c(const uint8_t* data, size_t length);
+    uint32_t crc32c(uint32_t crc, const uint8_t* data, size_t length);
+
+    bool isCrc32cAccelerated();
+
+    size_t writeChecksummedPair(const Header* header, std::ostream& output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
+    size_t writeChecksummedPair(const Header* header, uint8_t* output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
+
+    size_t readChecksummedPair(const Header* header, std::istream& input, uint8_t* name, size_t* nameLength, uint8_t* value, size_t* valueLength);
+    size_t readChecksummedPair(const Header* header, const uint8_t* input, uint8_t* name, size_t* nameLength, uint8_t* value, size_t* valueLength);
+
+    ValidationResult validatePackage(const uint8_t* package, size_t packageLength);
+}
+
+#endif
@@ -0,0 +1,247 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_CODEC_HXX_INCLUDED
+#define BDP_CODEC_HXX_INCLUDED
+
+#include "bdp.hxx"
+#include "view.hxx"
+
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace BDP {
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    constexpr bool NATIVE_LITTLE_ENDIAN = false;
+#else
+    constexpr bool NATIVE_LITTLE_ENDIAN = true;
+#endif
+
+    template<uint8_t BitSize>
+    struct LengthCodec {
+        static_assert(BitSize == 8u || BitSize == 16u || BitSize == 32u || BitSize == 64u, "BitSize must be 8, 16, 32 or 64");
+
+        using Type = std::conditional_t<BitSize == 8u, uint8_t,
+                     std::conditional_t<BitSize == 16u, uint16_t,
+                     std::conditional_t<BitSize == 32u, uint32_t, uint64_t>>>;
+
+        static constexpr uint8_t BIT_SIZE = BitSize;
+        static constexpr uint8_t BYTE_SIZE = BitSize / 8u;
+        static constexpr size_t MAX_LENGTH = static_cast<size_t>(static_cast<Type>(-1));
+
+        static void encode(uint8_t* destination, size_t length) {
+            Type value = static_cast<Type>(length);
+
+            if constexpr(!NATIVE_LITTLE_ENDIAN)
+                value = swap(value);
+
+            memcpy(destination, &value, BYTE_SIZE);
+        }
+
+        static size_t decode(const uint8_t* source) {
+            Type value;
+            memcpy(&value, source, BYTE_SIZE);
+
+            if constexpr(!NATIVE_LITTLE_ENDIAN)
+                value = swap(value);
+
+            return static_cast<size_t>(value);
+        }
+
+    private:
+        static constexpr Type swap(Type value) {
+            Type result = 0u;
+
+            for(uint8_t i = 0u; i < BYTE_SIZE; ++i, value >>= 8u)
+                result = static_cast<Type>((result << 8u) | (value & 0xFFu));
+
+            return result;
+        }
+    };
+
+    template<uint8_t NameBits, uint8_t ValueBits>
+    struct Codec {
+        using NameLength = LengthCodec<NameBits>;
+        using ValueLength = LengthCodec<ValueBits>;
+
+        static constexpr uint8_t NAME_LENGTH_BIT_SIZE = NameBits;
+        static constexpr uint8_t VALUE_LENGTH_BIT_SIZE = ValueBits;
+
+        static constexpr uint8_t NAME_LENGTH_BYTE_SIZE = NameLength::BYTE_SIZE;
+        static constexpr uint8_t VALUE_LENGTH_BYTE_SIZE = ValueLength::BYTE_SIZE;
+
+        static constexpr size_t NAME_MAX_LENGTH = NameLength::MAX_LENGTH;
+        static constexpr size_t VALUE_MAX_LENGTH = ValueLength::MAX_LENGTH;
+
+        static constexpr uint8_t HEADER_BYTE = static_cast<uint8_t>((NameBits << 1u) | (ValueBits >> 3u));
+
+        static constexpr size_t getPairLength(size_t nameLength, size_t valueLength) {
+            return NAME_LENGTH_BYTE_SIZE + nameLength + VALUE_LENGTH_BYTE_SIZE + valueLength;
+        }
+
+        static size_t writeHeader(uint8_t* output) {
+            memcpy(output, "BDP", HEADER_LENGTH - 1u);
+            output[HEADER_LENGTH - 1u] = HEADER_BYTE;
+
+            return HEADER_LENGTH;
+        }
+
+        static size_t writeName(uint8_t* output, const uint8_t* name, size_t nameLength) {
+            NameLength::encode(output, nameLength);
+            memcpy(output + NAME_LENGTH_BYTE_SIZE, name, nameLength);
+
+            return NAME_LENGTH_BYTE_SIZE + nameLength;
+        }
+
+        static size_t writeValue(uint8_t* output, const uint8_t* value, size_t valueLength) {
+            ValueLength::encode(output, valueLength);
+            memcpy(output + VALUE_LENGTH_BYTE_SIZE, value, valueLength);
+
+            return VALUE_LENGTH_BYTE_SIZE + valueLength;
+        }
+
+        static size_t writePair(uint8_t* output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+            size_t count = writeName(output, name, nameLength);
+            return count + writeValue(output + count, value, valueLength);
+        }
+
+        // Doesn't check bounds; use this only on packages that are known to be valid.
+        static size_t readPair(const uint8_t* input, PairView& pair) {
+            size_t nameLength = NameLength::decode(input);
+            const uint8_t* index = input + NAME_LENGTH_BYTE_SIZE;
+
+            pair.name = std::string_view(reinterpret_cast<const char*>(index), nameLength);
+            index += nameLength;
+
+            size_t valueLength = ValueLength::decode(index);
+            index += VALUE_LENGTH_BYTE_SIZE;
+
+            pair.value = std::string_view(reinterpret_cast<const char*>(index), valueLength);
+
+            return static_cast<size_t>(index + valueLength - input);
+        }
+
+        static size_t readPair(const uint8_t* input, const uint8_t* end, PairView& pair) {
+            const uint8_t* index = input;
+
+            if(static_cast<size_t>(end - index) < NAME_LENGTH_BYTE_SIZE)
+                throw std::runtime_error("package: Truncated name length");
+
+            size_t nameLength = NameLength::decode(index);
+            index += NAME_LENGTH_BYTE_SIZE;
+
+            if(static_cast<size_t>(end - index) < nameLength)
+                throw std::runtime_error("package: Truncated name");
+
+            pair.name = std::string_view(reinterpret_cast<const char*>(index), nameLength);
+            index += nameLength;
+
+            if(static_cast<size_t>(end - index) < VALUE_LENGTH_BYTE_SIZE)
+                throw std::runtime_error("package: Truncated value length");
+
+            size_t valueLength = ValueLength::decode(index);
+            index += VALUE_LENGTH_BYTE_SIZE;
+
+            if(static_cast<size_t>(end - index) < valueLength)
+                throw std::runtime_error("package: Truncated value");
+
+            pair.value = std::string_view(reinterpret_cast<const char*>(index), valueLength);
+
+            return static_cast<size_t>(index + valueLength - input);
+        }
+
+        // Calls the function for every pair in the input, which must not contain the header.
+        // Returns the number of pairs.
+        template<typename Function>
+        static size_t forEach(const uint8_t* input, size_t inputLength, Function&& function) {
+            const uint8_t* end = input + inputLength;
+            size_t count = 0u;
+            PairView pair;
+
+            while(input != end) {
+                input += readPair(input, end, pair);
+                function(static_cast<const PairView&>(pair));
+                ++count;
+            }
+
+            return count;
+        }
+    };
+
+    inline uint8_t getHeaderByte(uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
+        return static_cast<uint8_t>((nameLengthBitSize << 1u) | (valueLengthBitSize >> 3u));
+    }
+
+    inline uint8_t getHeaderByte(const Header* header) {
+        return getHeaderByte(header->NAME_LENGTH_BIT_SIZE, header->VALUE_LENGTH_BIT_SIZE);
+    }
+
+    // Calls the function with the Codec that matches the header byte, and returns its result.
+    template<typename Function>
+    decltype(auto) dispatch(uint8_t headerByte, Function&& function) {
+        if constexpr(sizeof(size_t) < 8)
+            if((headerByte & 0x88u) != 0u)
+                throw std::runtime_error("Cannot process 64-bit BDP packages with this version of the library; use the 64-bit version instead");
+
+        switch(headerByte) {
+            case 0x11u: return function(Codec<8u, 8u>());
+            case 0x12u: return function(Codec<8u, 16u>());
+            case 0x14u: return function(Codec<8u, 32u>());
+            case 0x18u: return function(Codec<8u, 64u>());
+            case 0x21u: return function(Codec<16u, 8u>());
+            case 0x22u: return function(Codec<16u, 16u>());
+            case 0x24u: return function(Codec<16u, 32u>());
+            case 0x28u: return function(Codec<16u, 64u>());
+            case 0x41u: return function(Codec<32u, 8u>());
+            case 0x42u: return function(Codec<32u, 16u>());
+            case 0x44u: return function(Codec<32u, 32u>());
+            case 0x48u: return function(Codec<32u, 64u>());
+            case 0x81u: return function(Codec<64u, 8u>());
+            case 0x82u: return function(Codec<64u, 16u>());
+            case 0x84u: return function(Codec<64u, 32u>());
+            case 0x88u: return function(Codec<64u, 64u>());
+            default: throw std::invalid_argument("headerByte: Invalid package header");
+        }
+    }
+
+    template<typename Function>
+    decltype(auto) dispatch(const Header* header, Function&& function) {
+        return dispatch(getHeaderByte(header), std::forward<Function>(function));
+    }
+
+    // Reads the header, then runs the loop specialized for the package type.
+    // Returns the number of pairs.
+    template<typename Function>
+    size_t forEachPair(const uint8_t* package, size_t packageLength, Function&& function) {
+        if(packageLength < HEADER_LENGTH || memcmp(package, "BDP", HEADER_LENGTH - 1u) != 0)
+            throw std::invalid_argument("package: Invalid package header");
+
+        return dispatch(package[HEADER_LENGTH - 1u], [&](auto codec) {
+            return decltype(codec)::forEach(package + HEADER_LENGTH, packageLength - HEADER_LENGTH, function);
+        });
+    }
+}
+
+#endif
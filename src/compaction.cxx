@@ -0,0 +1,535 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "compaction.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+
+/// How many runs are merged at once. If there are more, they are merged in several passes, to bound the number of open files.
+const size_t COMPACTION_MERGE_FAN_IN = 64u;
+/// The estimated memory which a sort entry uses, besides its name.
+const size_t COMPACTION_ENTRY_OVERHEAD = 64u;
+/// The length of the value of a run entry: the offset and length of the value in the input.
+const size_t COMPACTION_RUN_VALUE_LENGTH = 2u * sizeof(uint64_t);
+
+std::atomic<uint64_t> COMPACTION_RUN_COUNTER(0u);
+
+// Only the names are sorted; the entries point to the values in the input, which are copied to the output at the end.
+struct SortEntry {
+    std::string name;
+    uint64_t valueOffset;
+    uint64_t valueLength;
+};
+
+struct SortValue {
+    uint64_t offset;
+    uint64_t length;
+};
+
+using RunSink = std::function<void(const std::string& name, std::vector<SortValue>& values)>;
+
+class TemporaryRun {
+public:
+    explicit TemporaryRun(const std::filesystem::path& directory) {
+        uint64_t time = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+
+        path = directory / ("bdp-run-" + std::to_string(time) + "-" + std::to_string(COMPACTION_RUN_COUNTER++));
+        stream.open(path, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+
+        if(!stream.is_open())
+            throw std::runtime_error("temporaryDirectory: Cannot create a temporary file");
+    }
+
+    ~TemporaryRun() {
+        stream.close();
+
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+
+    TemporaryRun(const TemporaryRun&) = delete;
+    TemporaryRun& operator=(const TemporaryRun&) = delete;
+
+    std::fstream stream;
+
+private:
+    std::filesystem::path path;
+};
+
+class RunSource {
+public:
+    virtual ~RunSource() = default;
+
+    virtual bool next(SortEntry& entry) = 0;
+};
+
+bool readCompactionName(const BDP::Header* header, std::istream& input, std::string& name) {
+    if(input.peek() == std::char_traits<char>::eof())
+        return false;
+
+    uint8_t lengthBytes[sizeof(uint64_t)];
+    size_t nameLength = 0u;
+
+    input.read((char*) lengthBytes, header->NAME_LENGTH_BYTE_SIZE);
+
+    if(static_cast<size_t>(input.gcount()) != header->NAME_LENGTH_BYTE_SIZE)
+        throw std::runtime_error("input: Truncated name length");
+
+    BDP::bytesToLength(nameLength, lengthBytes, header->NAME_LENGTH_BYTE_SIZE);
+
+    name.resize(nameLength);
+    input.read(name.data(), static_cast<std::streamsize>(nameLength));
+
+    if(static_cast<size_t>(input.gcount()) != nameLength)
+        throw std::runtime_error("input: Truncated name");
+
+    return true;
+}
+
+size_t readCompactionValueLength(const BDP::Header* header, std::istream& input) {
+    uint8_t lengthBytes[sizeof(uint64_t)];
+    size_t valueLength = 0u;
+
+    input.read((char*) lengthBytes, header->VALUE_LENGTH_BYTE_SIZE);
+
+    if(static_cast<size_t>(input.gcount()) != header->VALUE_LENGTH_BYTE_SIZE)
+        throw std::runtime_error("input: Truncated value length");
+
+    BDP::bytesToLength(valueLength, lengthBytes, header->VALUE_LENGTH_BYTE_SIZE);
+
+    return valueLength;
+}
+
+void readCompactionValue(std::istream& input, std::string& value, size_t valueLength) {
+    value.resize(valueLength);
+    input.read(value.data(), static_cast<std::streamsize>(valueLength));
+
+    if(static_cast<size_t>(input.gcount()) != valueLength)
+        throw std::runtime_error("input: Truncated value");
+}
+
+void writeRunEntry(const BDP::Header* runHeader, std::ostream& output, const std::string& name, const SortValue& value) {
+    uint8_t bytes[COMPACTION_RUN_VALUE_LENGTH];
+
+    memcpy(bytes, &value.offset, sizeof(uint64_t));
+    memcpy(bytes + sizeof(uint64_t), &value.length, sizeof(uint64_t));
+
+    BDP::writeName(runHeader, output, reinterpret_cast<const uint8_t*>(name.data()), name.size());
+    BDP::writeValue(runHeader, output, bytes, COMPACTION_RUN_VALUE_LENGTH);
+}
+
+class MemoryRunSource : public RunSource {
+public:
+    explicit MemoryRunSource(std::vector<SortEntry>& entries) : entries(entries), index(0u) { }
+
+    bool next(SortEntry& entry) override {
+        if(index == entries.size())
+            return false;
+
+        entry = std::move(entries[index++]);
+
+        return true;
+    }
+
+private:
+    std::vector<SortEntry>& entries;
+    size_t index;
+};
+
+class FileRunSource : public RunSource {
+public:
+    FileRunSource(TemporaryRun& run, const BDP::Header& runHeader) : run(run), runHeader(runHeader) {
+        run.stream.flush();
+        run.stream.clear();
+        run.stream.seekg(0);
+    }
+
+    bool next(SortEntry& entry) override {
+        if(!readCompactionName(&runHeader, run.stream, entry.name))
+            return false;
+
+        uint8_t bytes[COMPACTION_RUN_VALUE_LENGTH];
+        size_t valueLength = 0u;
+
+        BDP::readValue(&runHeader, run.stream, bytes, &valueLength);
+
+        if(valueLength != COMPACTION_RUN_VALUE_LENGTH)
+            throw std::runtime_error("temporaryDirectory: Corrupted temporary file");
+
+        memcpy(&entry.valueOffset, bytes, sizeof(uint64_t));
+        memcpy(&entry.valueLength, bytes + sizeof(uint64_t), sizeof(uint64_t));
+
+        return true;
+    }
+
+private:
+    TemporaryRun& run;
+    const BDP::Header& runHeader;
+};
+
+// Merges sorted runs, and passes every name to the sink along with all of its values.
+void mergeRuns(std::vector<std::unique_ptr<RunSource>>& sources, const RunSink& sink) {
+    std::vector<SortEntry> current(sources.size());
+    std::vector<size_t> heap;
+
+    auto greater = [&current](size_t first, size_t second) {
+        int comparison = current[first].name.compare(current[second].name);
+        return comparison != 0 ? comparison > 0 : first > second;
+    };
+
+    for(size_t i = 0u; i < sources.size(); ++i) {
+        if(sources[i]->next(current[i]))
+            heap.push_back(i);
+    }
+
+    std::make_heap(heap.begin(), heap.end(), greater);
+
+    std::string name;
+    std::vector<SortValue> values;
+
+    while(!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), greater);
+        size_t source = heap.back();
+        heap.pop_back();
+
+        if(!values.empty() && current[source].name != name) {
+            sink(name, values);
+            values.clear();
+        }
+
+        if(values.empty())
+            name = current[source].name;
+
+        values.push_back({ current[source].valueOffset, current[source].valueLength });
+
+        if(sources[source]->next(current[source])) {
+            heap.push_back(source);
+            std::push_heap(heap.begin(), heap.end(), greater);
+        }
+    }
+
+    if(!values.empty())
+        sink(name, values);
+}
+
+// The values are ordered by their offset in the input, which is the order in which they were written.
+void reduceSortValues(std::vector<SortValue>& values, bool keepAll) {
+    std::sort(values.begin(), values.end(), [](const SortValue& first, const SortValue& second) {
+        return first.offset < second.offset;
+    });
+
+    if(!keepAll) {
+        values.front() = values.back();
+        values.resize(1u);
+    }
+}
+
+void sortEntries(std::vector<SortEntry>& entries, bool keepAll) {
+    std::stable_sort(entries.begin(), entries.end(), [](const SortEntry& first, const SortEntry& second) {
+        return first.name < second.name;
+    });
+
+    if(keepAll)
+        return;
+
+    // The newest entry of every name is the last one, as the sort is stable.
+    size_t count = 0u;
+
+    for(size_t i = 0u; i < entries.size(); ++i) {
+        if(i + 1u < entries.size() && entries[i + 1u].name == entries[i].name)
+            continue;
+        if(count != i)
+            entries[count] = std::move(entries[i]);
+
+        ++count;
+    }
+
+    entries.erase(entries.begin() + static_cast<std::ptrdiff_t>(count), entries.end());
+}
+
+void checkCompactionOptions(const BDP::CompactionOptions& options) {
+    if(options.memoryLimit == 0u)
+        throw std::invalid_argument("memoryLimit");
+    if(options.bufferSize == 0u)
+        throw std::invalid_argument("bufferSize");
+}
+
+size_t writeReducedValue(const BDP::Header* header, std::ostream& output, const std::string& name, const std::vector<std::string>& values,
+                         const BDP::CompactionReducer& reducer, std::string& result) {
+    result.clear();
+    reducer(name, values, result);
+
+    if(result.size() > header->VALUE_MAX_LENGTH)
+        throw std::runtime_error("reducer: The reduced value is too long");
+
+    BDP::writeName(header, output, reinterpret_cast<const uint8_t*>(name.data()), name.size());
+    return BDP::writeValue(header, output, reinterpret_cast<const uint8_t*>(result.data()), result.size());
+}
+
+size_t BDP::sortPackage(std::istream& input, std::ostream& output) {
+    return sortPackage(input, output, CompactionOptions());
+}
+
+size_t BDP::sortPackage(std::istream& input, std::ostream& output, const CompactionOptions& options) {
+    checkCompactionOptions(options);
+
+    std::unique_ptr<Header> header(readHeader(input));
+    Header runHeader(header->NAME_LENGTH_BIT_SIZE, 8u);
+
+    std::filesystem::path directory = options.temporaryDirectory.empty() ? std::filesystem::temp_directory_path()
+                                                                         : std::filesystem::path(options.temporaryDirectory);
+    bool keepAll = static_cast<bool>(options.reducer);
+
+    std::vector<std::unique_ptr<TemporaryRun>> runs;
+    std::vector<SortEntry> entries;
+    size_t memory = 0u;
+
+    // Writes the entries which are in memory to a new sorted run.
+    auto spill = [&]() {
+        sortEntries(entries, keepAll);
+
+        auto run = std::make_unique<TemporaryRun>(directory);
+
+        for(const SortEntry& entry : entries)
+            writeRunEntry(&runHeader, run->stream, entry.name, { entry.valueOffset, entry.valueLength });
+
+        if(!run->stream.flush())
+            throw std::runtime_error("temporaryDirectory: Cannot write to a temporary file");
+
+        runs.push_back(std::move(run));
+        entries.clear();
+        memory = 0u;
+    };
+
+    // The values are skipped, so only the names and the value positions are held in memory.
+    std::string name;
+
+    while(readCompactionName(header.get(), input, name)) {
+        size_t valueLength = readCompactionValueLength(header.get(), input);
+        std::streampos position = input.tellg();
+
+        if(position == std::streampos(-1))
+            throw std::invalid_argument("input: The stream is not seekable");
+
+        input.seekg(static_cast<std::streamoff>(valueLength), std::ios::cur);
+
+        entries.push_back({ name, static_cast<uint64_t>(position), valueLength });
+        memory += name.size() + COMPACTION_ENTRY_OVERHEAD;
+
+        if(memory >= options.memoryLimit)
+            spill();
+    }
+
+    // The values are resolved by their offset, so the runs can be merged in any order.
+    while(runs.size() >= COMPACTION_MERGE_FAN_IN) {
+        std::vector<std::unique_ptr<TemporaryRun>> merged;
+
+        for(size_t first = 0u; first < runs.size(); first += COMPACTION_MERGE_FAN_IN) {
+            size_t last = std::min(first + COMPACTION_MERGE_FAN_IN, runs.size());
+
+            std::vector<std::unique_ptr<RunSource>> sources;
+            for(size_t i = first; i < last; ++i)
+                sources.push_back(std::make_unique<FileRunSource>(*runs[i], runHeader));
+
+            auto run = std::make_unique<TemporaryRun>(directory);
+
+            mergeRuns(sources, [&](const std::string& entryName, std::vector<SortValue>& values) {
+                reduceSortValues(values, keepAll);
+
+                for(const SortValue& value : values)
+                    writeRunEntry(&runHeader, run->stream, entryName, value);
+            });
+
+            if(!run->stream.flush())
+                throw std::runtime_error("temporaryDirectory: Cannot write to a temporary file");
+
+            merged.push_back(std::move(run));
+        }
+
+        runs = std::move(merged);
+    }
+
+    sortEntries(entries, keepAll);
+
+    std::vector<std::unique_ptr<RunSource>> sources;
+    for(auto& run : runs)
+        sources.push_back(std::make_unique<FileRunSource>(*run, runHeader));
+    sources.push_back(std::make_unique<MemoryRunSource>(entries));
+
+    uint8_t headerBytes[HEADER_LENGTH];
+    encodeHeader(headerBytes, header->NAME_LENGTH_BIT_SIZE, header->VALUE_LENGTH_BIT_SIZE);
+    output.write((char*) headerBytes, HEADER_LENGTH);
+
+    auto buffer = std::make_unique<uint8_t[]>(options.bufferSize);
+    std::vector<std::string> values;
+    std::string result;
+    size_t count = 0u;
+
+    // The values are streamed from the input to the output, in the order of the sorted names.
+    mergeRuns(sources, [&](const std::string& entryName, std::vector<SortValue>& entryValues) {
+        reduceSortValues(entryValues, keepAll);
+
+        if(!keepAll) {
+            input.clear();
+            input.seekg(static_cast<std::streamoff>(entryValues.front().offset));
+
+            writeName(header.get(), output, reinterpret_cast<const uint8_t*>(entryName.data()), entryName.size());
+            writeSizedData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, input,
+                           static_cast<size_t>(entryValues.front().length), buffer.get(), options.bufferSize);
+        } else {
+            values.resize(entryValues.size());
+
+            for(size_t i = 0u; i < entryValues.size(); ++i) {
+                input.clear();
+                input.seekg(static_cast<std::streamoff>(entryValues[i].offset));
+
+                readCompactionValue(input, values[i], static_cast<size_t>(entryValues[i].length));
+            }
+
+            writeReducedValue(header.get(), output, entryName, values, options.reducer, result);
+        }
+
+        ++count;
+    });
+
+    return count;
+}
+
+size_t BDP::mergePackages(const std::vector<std::istream*>& inputs, std::ostream& output) {
+    return mergePackages(inputs, output, CompactionOptions());
+}
+
+size_t BDP::mergePackages(const std::vector<std::istream*>& inputs, std::ostream& output, const CompactionOptions& options) {
+    checkCompactionOptions(options);
+
+    struct MergeInput {
+        std::unique_ptr<Header> header;
+        std::string name;
+        bool started;
+    };
+
+    std::vector<MergeInput> states(inputs.size());
+    uint8_t nameLengthBitSize = 8u;
+    uint8_t valueLengthBitSize = 8u;
+
+    // The output uses the largest length bit sizes, so every pair fits.
+    for(size_t i = 0u; i < inputs.size(); ++i) {
+        states[i].header.reset(readHeader(*inputs[i]));
+        states[i].started = false;
+
+        nameLengthBitSize = std::max(nameLengthBitSize, states[i].header->NAME_LENGTH_BIT_SIZE);
+        valueLengthBitSize = std::max(valueLengthBitSize, states[i].header->VALUE_LENGTH_BIT_SIZE);
+    }
+
+    uint8_t headerBytes[HEADER_LENGTH];
+    encodeHeader(headerBytes, nameLengthBitSize, valueLengthBitSize);
+    output.write((char*) headerBytes, HEADER_LENGTH);
+
+    Header header = decodeHeader(headerBytes);
+
+    std::vector<size_t> heap;
+
+    auto greater = [&states](size_t first, size_t second) {
+        int comparison = states[first].name.compare(states[second].name);
+        return comparison != 0 ? comparison > 0 : first > second;
+    };
+
+    std::string previous;
+
+    // Reads the next name of an input, and checks that the names are strictly ascending.
+    auto advance = [&](size_t index) {
+        MergeInput& state = states[index];
+        previous.swap(state.name);
+
+        if(!readCompactionName(state.header.get(), *inputs[index], state.name))
+            return;
+        if(state.started && state.name <= previous)
+            throw std::runtime_error("input: The package is not sorted by name");
+
+        state.started = true;
+
+        heap.push_back(index);
+        std::push_heap(heap.begin(), heap.end(), greater);
+    };
+
+    for(size_t i = 0u; i < inputs.size(); ++i)
+        advance(i);
+
+    auto buffer = std::make_unique<uint8_t[]>(options.bufferSize);
+    bool keepAll = static_cast<bool>(options.reducer);
+
+    std::vector<size_t> group;
+    std::vector<std::string> values;
+    std::string name;
+    std::string result;
+    size_t count = 0u;
+
+    while(!heap.empty()) {
+        group.clear();
+
+        // Ties are broken by the input index, so the group goes from the oldest input to the newest.
+        do {
+            std::pop_heap(heap.begin(), heap.end(), greater);
+            group.push_back(heap.back());
+            heap.pop_back();
+        } while(!heap.empty() && states[heap.front()].name == states[group.front()].name);
+
+        name = states[group.front()].name;
+
+        if(!keepAll) {
+            for(size_t i = 0u; i + 1u < group.size(); ++i)
+                skipValue(states[group[i]].header.get(), *inputs[group[i]]);
+
+            size_t newest = group.back();
+            size_t valueLength = readCompactionValueLength(states[newest].header.get(), *inputs[newest]);
+
+            writeName(&header, output, reinterpret_cast<const uint8_t*>(name.data()), name.size());
+            writeSizedData(header.VALUE_MAX_LENGTH, header.VALUE_LENGTH_BYTE_SIZE, output, *inputs[newest], valueLength,
+                           buffer.get(), options.bufferSize);
+        } else {
+            values.resize(group.size());
+
+            for(size_t i = 0u; i < group.size(); ++i) {
+                size_t valueLength = readCompactionValueLength(states[group[i]].header.get(), *inputs[group[i]]);
+                readCompactionValue(*inputs[group[i]], values[i], valueLength);
+            }
+
+            writeReducedValue(&header, output, name, values, options.reducer, result);
+        }
+
+        for(size_t index : group)
+            advance(index);
+
+        ++count;
+    }
+
+    return count;
+}
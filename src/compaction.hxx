@@ -0,0 +1,60 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_COMPACTION_HXX_INCLUDED
+#define BDP_COMPACTION_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BDP {
+    /// How much memory the names of a sorted run can use, before the run is written to a temporary file.
+    const size_t DEFAULT_COMPACTION_MEMORY_LIMIT = 67108864u;
+    const size_t DEFAULT_COMPACTION_BUFFER_SIZE = 65536u;
+
+    /// Combines the values of a name, from the oldest to the newest, into one value.
+    using CompactionReducer = std::function<void(std::string_view name, const std::vector<std::string>& values, std::string& result)>;
+
+    struct CompactionOptions {
+        size_t memoryLimit = DEFAULT_COMPACTION_MEMORY_LIMIT;
+        size_t bufferSize = DEFAULT_COMPACTION_BUFFER_SIZE;
+
+        std::string temporaryDirectory;
+        CompactionReducer reducer;
+    };
+
+    size_t sortPackage(std::istream& input, std::ostream& output);
+    size_t sortPackage(std::istream& input, std::ostream& output, const CompactionOptions& options);
+
+    size_t mergePackages(const std::vector<std::istream*>& inputs, std::ostream& output);
+    size_t mergePackages(const std::vector<std::istream*>& inputs, std::ostream& output, const CompactionOptions& options);
+}
+
+#endif
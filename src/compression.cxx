@@ -0,0 +1,544 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "compression.hxx"
+#include "metrics.hxx"
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+// The blocks use the LZ4 block format: a token with the literal and match lengths, the literals,
+// then a 2-byte little-endian offset. The end-of-block rules of LZ4 are kept, so that every
+// block can also be decoded by a stock LZ4 decoder.
+
+/// The minimum match length.
+const size_t LZ_MIN_MATCH = 4u;
+/// The last bytes of a block are always literals.
+const size_t LZ_LAST_LITERALS = 5u;
+/// The last match must start at least this many bytes before the end of the block.
+const size_t LZ_MATCH_FIND_LIMIT = 12u;
+/// The maximum distance between a match and its source.
+const size_t LZ_MAX_OFFSET = 65535u;
+const uint8_t LZ_HASH_BITS = 12u;
+
+/// The maximum length of a block header (two varints).
+const size_t BLOCK_HEADER_MAX_LENGTH = 6u;
+/// The maximum length of the second varint of a block header.
+const size_t BLOCK_STORED_VARINT_MAX_LENGTH = 3u;
+
+uint32_t readLz32(const uint8_t* input) {
+    uint32_t value;
+    memcpy(&value, input, sizeof(value));
+
+    return value;
+}
+
+uint32_t hashLz32(uint32_t value) {
+    return (value * 2654435761u) >> (32u - LZ_HASH_BITS);
+}
+
+size_t getLzLengthBytes(size_t length) {
+    return length >= 15u ? (length - 15u) / 255u + 1u : 0u;
+}
+
+uint8_t* writeLzLength(uint8_t* output, size_t length) {
+    for(length -= 15u; length >= 255u; length -= 255u)
+        *output++ = 255u;
+    *output++ = static_cast<uint8_t>(length);
+
+    return output;
+}
+
+// Returns 0 if the compressed block would not fit in the output.
+size_t compressLzBlock(const uint8_t* input, size_t inputLength, uint8_t* output, size_t outputLimit) {
+    uint32_t table[1u << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    uint8_t* outputIndex = output;
+    uint8_t* outputEnd = output + outputLimit;
+
+    size_t anchor = 0u;
+    size_t index = 0u;
+
+    auto emit = [&](size_t literalLength, size_t offset, size_t matchLength) -> bool {
+        size_t required = 1u + getLzLengthBytes(literalLength) + literalLength;
+
+        if(matchLength != 0u)
+            required += 2u + getLzLengthBytes(matchLength - LZ_MIN_MATCH);
+        if(required > static_cast<size_t>(outputEnd - outputIndex))
+            return false;
+
+        uint8_t* token = outputIndex++;
+        *token = static_cast<uint8_t>((literalLength < 15u ? literalLength : 15u) << 4u);
+
+        if(literalLength >= 15u)
+            outputIndex = writeLzLength(outputIndex, literalLength);
+
+        memcpy(outputIndex, input + anchor, literalLength);
+        outputIndex += literalLength;
+
+        if(matchLength == 0u)
+            return true;
+
+        *outputIndex++ = static_cast<uint8_t>(offset);
+        *outputIndex++ = static_cast<uint8_t>(offset >> 8u);
+
+        size_t length = matchLength - LZ_MIN_MATCH;
+        *token |= static_cast<uint8_t>(length < 15u ? length : 15u);
+
+        if(length >= 15u)
+            outputIndex = writeLzLength(outputIndex, length);
+
+        return true;
+    };
+
+    if(inputLength > LZ_MATCH_FIND_LIMIT) {
+        size_t matchLimit = inputLength - LZ_LAST_LITERALS;
+        size_t findLimit = inputLength - LZ_MATCH_FIND_LIMIT;
+
+        while(index <= findLimit) {
+            uint32_t sequence = readLz32(input + index);
+            uint32_t hash = hashLz32(sequence);
+            size_t candidate = table[hash];
+
+            table[hash] = static_cast<uint32_t>(index);
+
+            if(candidate >= index || index - candidate > LZ_MAX_OFFSET || readLz32(input + candidate) != sequence) {
+                // Skip faster through data which doesn't compress.
+                index += 1u + ((index - anchor) >> 6u);
+                continue;
+            }
+
+            size_t matchLength = LZ_MIN_MATCH;
+            while(index + matchLength < matchLimit && input[candidate + matchLength] == input[index + matchLength])
+                ++matchLength;
+
+            if(!emit(index - anchor, index - candidate, matchLength))
+                return 0u;
+
+            index += matchLength;
+            anchor = index;
+
+            if(index - 2u <= findLimit)
+                table[hashLz32(readLz32(input + index - 2u))] = static_cast<uint32_t>(index - 2u);
+        }
+    }
+
+    if(!emit(inputLength - anchor, 0u, 0u))
+        return 0u;
+
+    return static_cast<size_t>(outputIndex - output);
+}
+
+void decompressLzBlock(const uint8_t* input, size_t inputLength, uint8_t* output, size_t outputLength) {
+    const uint8_t* index = input;
+    const uint8_t* end = input + inputLength;
+    size_t position = 0u;
+
+    auto readLength = [&](size_t length) -> size_t {
+        uint8_t byte;
+
+        do {
+            if(index == end)
+                throw std::runtime_error("value: Truncated compressed block");
+
+            byte = *index++;
+            length += byte;
+
+            if(length > outputLength)
+                throw std::runtime_error("value: Invalid compressed block");
+        } while(byte == 255u);
+
+        return length;
+    };
+
+    while(true) {
+        if(index == end)
+            throw std::runtime_error("value: Truncated compressed block");
+
+        uint8_t token = *index++;
+        size_t literalLength = token >> 4u;
+
+        if(literalLength == 15u)
+            literalLength = readLength(literalLength);
+
+        if(literalLength > static_cast<size_t>(end - index) || literalLength > outputLength - position)
+            throw std::runtime_error("value: Invalid compressed block");
+
+        memcpy(output + position, index, literalLength);
+        index += literalLength;
+        position += literalLength;
+
+        // The last sequence has no match.
+        if(index == end)
+            break;
+
+        if(end - index < 2)
+            throw std::runtime_error("value: Truncated compressed block");
+
+        size_t offset = static_cast<size_t>(index[0]) | (static_cast<size_t>(index[1]) << 8u);
+        index += 2;
+
+        if(offset == 0u || offset > position)
+            throw std::runtime_error("value: Invalid compressed block");
+
+        size_t matchLength = token & 15u;
+
+        if(matchLength == 15u)
+            matchLength = readLength(matchLength);
+
+        matchLength += LZ_MIN_MATCH;
+
+        if(matchLength > outputLength - position)
+            throw std::runtime_error("value: Invalid compressed block");
+
+        uint8_t* destination = output + position;
+        const uint8_t* source = destination - offset;
+
+        // Overlapping matches repeat the last bytes, so they are copied byte by byte.
+        if(offset >= matchLength) {
+            memcpy(destination, source, matchLength);
+        } else {
+            for(size_t i = 0u; i < matchLength; ++i)
+                destination[i] = source[i];
+        }
+
+        position += matchLength;
+    }
+
+    if(position != outputLength)
+        throw std::runtime_error("value: Invalid compressed block");
+}
+
+size_t writeBlockVarint(uint8_t* output, size_t value) {
+    size_t count = 0u;
+
+    while(value >= 0x80u) {
+        output[count++] = static_cast<uint8_t>(value | 0x80u);
+        value >>= 7u;
+    }
+    output[count++] = static_cast<uint8_t>(value);
+
+    return count;
+}
+
+size_t readBlockVarint(const uint8_t*& input, const uint8_t* end) {
+    size_t value = 0u;
+
+    for(uint8_t shift = 0u; shift < 8u * sizeof(size_t); shift += 7u) {
+        if(input == end)
+            throw std::runtime_error("value: Truncated compressed block header");
+
+        uint8_t byte = *input++;
+        value |= static_cast<size_t>(byte & 0x7Fu) << shift;
+
+        if((byte & 0x80u) == 0u)
+            return value;
+    }
+
+    throw std::runtime_error("value: Invalid compressed block header");
+}
+
+struct CompressedBlock {
+    size_t rawLength;
+    size_t storedLength;
+    bool compressed;
+    const uint8_t* data;
+};
+
+// Every block starts with its raw length, then its stored length shifted left by one, with
+// the lowest bit set if the block is compressed. Blocks which don't compress are stored as they are.
+CompressedBlock readCompressedBlock(const uint8_t*& input, const uint8_t* end) {
+    CompressedBlock block;
+
+    block.rawLength = readBlockVarint(input, end);
+
+    size_t stored = readBlockVarint(input, end);
+
+    block.storedLength = stored >> 1u;
+    block.compressed = (stored & 1u) != 0u;
+    block.data = input;
+
+    if(block.rawLength > BDP::COMPRESSION_BLOCK_SIZE || block.storedLength > static_cast<size_t>(end - input) ||
+       (!block.compressed && block.storedLength != block.rawLength))
+        throw std::runtime_error("value: Invalid compressed block header");
+
+    input += block.storedLength;
+
+    return block;
+}
+
+void decodeCompressedBlock(const CompressedBlock& block, uint8_t* output) {
+    if(block.compressed)
+        decompressLzBlock(block.data, block.storedLength, output, block.rawLength);
+    else
+        memcpy(output, block.data, block.rawLength);
+}
+
+void checkCompressedHeader(const BDP::Header* header) {
+    if((header->FLAGS & BDP::HEADER_FLAG_COMPRESSED) == 0u)
+        throw std::invalid_argument("header: The package is not compressed");
+    // The compressed pair functions write plain name entries.
+    if((header->FLAGS & BDP::HEADER_FLAG_NAME_DICTIONARY) != 0u)
+        throw std::invalid_argument("header: Compressed packages can't have a name dictionary");
+}
+
+size_t BDP::getMaxCompressedLength(size_t valueLength) {
+    size_t blocks = (valueLength + COMPRESSION_BLOCK_SIZE - 1u) / COMPRESSION_BLOCK_SIZE;
+
+    return valueLength + blocks * BLOCK_HEADER_MAX_LENGTH;
+}
+
+size_t BDP::compressValue(const uint8_t* value, size_t valueLength, uint8_t* output) {
+    size_t index = 0u;
+
+    for(size_t offset = 0u; offset < valueLength; offset += COMPRESSION_BLOCK_SIZE) {
+        size_t rawLength = valueLength - offset < COMPRESSION_BLOCK_SIZE ? valueLength - offset : COMPRESSION_BLOCK_SIZE;
+
+        index += writeBlockVarint(output + index, rawLength);
+
+        // Compress after the longest possible stored length varint; the block is moved back once its length is known.
+        uint8_t* body = output + index + BLOCK_STORED_VARINT_MAX_LENGTH;
+        size_t storedLength = compressLzBlock(value + offset, rawLength, body, rawLength - 1u);
+
+        if(storedLength != 0u) {
+            size_t varintLength = writeBlockVarint(output + index, (storedLength << 1u) | 1u);
+
+            memmove(output + index + varintLength, body, storedLength);
+            index += varintLength + storedLength;
+        } else {
+            index += writeBlockVarint(output + index, rawLength << 1u);
+
+            memcpy(output + index, value + offset, rawLength);
+            index += rawLength;
+        }
+    }
+
+    return index;
+}
+
+size_t BDP::getDecompressedLength(const uint8_t* stored, size_t storedLength) {
+    const uint8_t* end = stored + storedLength;
+    size_t length = 0u;
+
+    while(stored != end)
+        length += readCompressedBlock(stored, end).rawLength;
+
+    return length;
+}
+
+size_t BDP::decompressValue(const uint8_t* stored, size_t storedLength, uint8_t* output, size_t outputLength) {
+    const uint8_t* end = stored + storedLength;
+    size_t position = 0u;
+
+    while(stored != end) {
+        CompressedBlock block = readCompressedBlock(stored, end);
+
+        if(block.rawLength > outputLength - position)
+            throw std::invalid_argument("outputLength");
+
+        decodeCompressedBlock(block, output + position);
+        position += block.rawLength;
+    }
+
+    return position;
+}
+
+size_t BDP::decompressValueRange(const uint8_t* stored, size_t storedLength, size_t offset, uint8_t* output, size_t length) {
+    const uint8_t* end = stored + storedLength;
+    size_t blockStart = 0u;
+    size_t count = 0u;
+
+    std::unique_ptr<uint8_t[]> scratch;
+
+    // Only the blocks which overlap the range are decompressed; the others are skipped using their headers.
+    while(stored != end && count < length) {
+        CompressedBlock block = readCompressedBlock(stored, end);
+        size_t blockEnd = blockStart + block.rawLength;
+
+        if(blockEnd > offset) {
+            size_t from = offset + count - blockStart;
+            size_t available = block.rawLength - from;
+            size_t wanted = length - count < available ? length - count : available;
+
+            if(from == 0u && wanted == block.rawLength) {
+                decodeCompressedBlock(block, output + count);
+            } else if(!block.compressed) {
+                memcpy(output + count, block.data + from, wanted);
+            } else {
+                if(!scratch) {
+                    scratch = std::make_unique<uint8_t[]>(COMPRESSION_BLOCK_SIZE);
+                    BDP_COUNT(BUFFER_ALLOCATIONS, 1u);
+                }
+
+                decodeCompressedBlock(block, scratch.get());
+                memcpy(output + count, scratch.get() + from, wanted);
+            }
+
+            count += wanted;
+        }
+
+        blockStart = blockEnd;
+    }
+
+    return count;
+}
+
+size_t BDP::writeCompressedValue(const BDP::Header* header, std::ostream& output, const uint8_t* value, size_t valueLength) {
+    checkCompressedHeader(header);
+
+    std::vector<uint8_t> stored(getMaxCompressedLength(valueLength));
+    size_t storedLength = compressValue(value, valueLength, stored.data());
+
+    if(storedLength > header->VALUE_MAX_LENGTH)
+        throw std::invalid_argument("valueLength");
+
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
+    return writeData(header->VALUE_MAX_LENGTH, header->VALUE_LENGTH_BYTE_SIZE, output, stored.data(), storedLength);
+}
+size_t BDP::writeCompressedValue(const BDP::Header* header, uint8_t* output, const uint8_t* value, size_t valueLength) {
+    checkCompressedHeader(header);
+
+    size_t storedLength = compressValue(value, valueLength, output + header->VALUE_LENGTH_BYTE_SIZE);
+
+    if(storedLength > header->VALUE_MAX_LENGTH)
+        throw std::invalid_argument("valueLength");
+
+    lengthToBytes(output, storedLength, header->VALUE_LENGTH_BYTE_SIZE);
+
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+    BDP_COUNT(BYTES_WRITTEN, header->VALUE_LENGTH_BYTE_SIZE + storedLength);
+
+    return header->VALUE_LENGTH_BYTE_SIZE + storedLength;
+}
+
+size_t BDP::writeCompressedPair(const BDP::Header* header, std::ostream& output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+    checkCompressedHeader(header);
+
+    size_t count = writeName(header, output, name, nameLength);
+    return count + writeCompressedValue(header, output, value, valueLength);
+}
+size_t BDP::writeCompressedPair(const BDP::Header* header, uint8_t* output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+    checkCompressedHeader(header);
+
+    size_t count = writeName(header, output, name, nameLength);
+    return count + writeCompressedValue(header, output + count, value, valueLength);
+}
+
+size_t BDP::readCompressedValue(const BDP::Header* header, const uint8_t* input, uint8_t* value, size_t* valueLength) {
+    checkCompressedHeader(header);
+
+    size_t storedLength = 0u;
+    bytesToLength(storedLength, input, header->VALUE_LENGTH_BYTE_SIZE);
+
+    const uint8_t* stored = input + header->VALUE_LENGTH_BYTE_SIZE;
+    const uint8_t* end = stored + storedLength;
+    size_t position = 0u;
+
+    // The value must be large enough for the decompressed data (see getDecompressedLength).
+    while(stored != end) {
+        CompressedBlock block = readCompressedBlock(stored, end);
+
+        decodeCompressedBlock(block, value + position);
+        position += block.rawLength;
+    }
+
+    BDP_COUNT(PAIRS_READ, 1u);
+    BDP_COUNT(BYTES_READ, header->VALUE_LENGTH_BYTE_SIZE + storedLength);
+
+    if(valueLength != nullptr)
+        *valueLength = position;
+
+    return header->VALUE_LENGTH_BYTE_SIZE + storedLength;
+}
+size_t BDP::readCompressedValue(const BDP::Header* header, std::istream& input, std::ostream& value) {
+    checkCompressedHeader(header);
+
+    uint8_t lengthBytes[sizeof(size_t)];
+    size_t storedLength = 0u;
+
+    input.read((char*) (&lengthBytes[0]), header->VALUE_LENGTH_BYTE_SIZE);
+
+    if(static_cast<size_t>(input.gcount()) != header->VALUE_LENGTH_BYTE_SIZE)
+        throw std::runtime_error("input: Truncated value length");
+
+    bytesToLength(storedLength, lengthBytes, header->VALUE_LENGTH_BYTE_SIZE);
+
+    // Only one block is held in memory at a time.
+    auto buffer = std::make_unique<uint8_t[]>(2u * COMPRESSION_BLOCK_SIZE + BLOCK_HEADER_MAX_LENGTH);
+    BDP_COUNT(BUFFER_ALLOCATIONS, 1u);
+
+    uint8_t* storedBlock = buffer.get();
+    uint8_t* rawBlock = buffer.get() + COMPRESSION_BLOCK_SIZE + BLOCK_HEADER_MAX_LENGTH;
+    size_t remaining = storedLength;
+
+    while(remaining > 0u) {
+        // Read the block header one varint byte at a time, as the block length is unknown.
+        size_t headerLength = 0u;
+        size_t varints = 0u;
+
+        while(varints < 2u) {
+            if(headerLength == BLOCK_HEADER_MAX_LENGTH || headerLength == remaining)
+                throw std::runtime_error("value: Invalid compressed block header");
+
+            int byte = input.get();
+
+            if(byte == std::char_traits<char>::eof())
+                throw std::runtime_error("input: Truncated value");
+
+            storedBlock[headerLength++] = static_cast<uint8_t>(byte);
+
+            if((byte & 0x80) == 0)
+                ++varints;
+        }
+
+        const uint8_t* index = storedBlock;
+        size_t rawLength = readBlockVarint(index, storedBlock + headerLength);
+        size_t stored = readBlockVarint(index, storedBlock + headerLength);
+        size_t blockLength = stored >> 1u;
+
+        if(rawLength > COMPRESSION_BLOCK_SIZE || blockLength > COMPRESSION_BLOCK_SIZE || blockLength > remaining - headerLength)
+            throw std::runtime_error("value: Invalid compressed block header");
+
+        input.read((char*) (storedBlock + headerLength), blockLength);
+
+        if(static_cast<size_t>(input.gcount()) != blockLength)
+            throw std::runtime_error("input: Truncated value");
+
+        index = storedBlock;
+        CompressedBlock block = readCompressedBlock(index, storedBlock + headerLength + blockLength);
+
+        decodeCompressedBlock(block, rawBlock);
+        value.write((char*) rawBlock, block.rawLength);
+
+        remaining -= headerLength + blockLength;
+    }
+
+    BDP_COUNT(PAIRS_READ, 1u);
+    BDP_COUNT(BYTES_READ, header->VALUE_LENGTH_BYTE_SIZE + storedLength);
+
+    return header->VALUE_LENGTH_BYTE_SIZE + storedLength;
+}
@@ -0,0 +1,54 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_COMPRESSION_HXX_INCLUDED
+#define BDP_COMPRESSION_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace BDP {
+    /// The maximum length of the data in one compressed block. Blocks can be decompressed independently.
+    const size_t COMPRESSION_BLOCK_SIZE = 65536u;
+
+    size_t getMaxCompressedLength(size_t valueLength);
+
+    size_t compressValue(const uint8_t* value, size_t valueLength, uint8_t* output);
+
+    size_t getDecompressedLength(const uint8_t* stored, size_t storedLength);
+    size_t decompressValue(const uint8_t* stored, size_t storedLength, uint8_t* output, size_t outputLength);
+    size_t decompressValueRange(const uint8_t* stored, size_t storedLength, size_t offset, uint8_t* output, size_t length);
+
+    size_t writeCompressedValue(const Header* header, std::ostream& output, const uint8_t* value, size_t valueLength);
+    size_t writeCompressedValue(const Header* header, uint8_t* output, const uint8_t* value, size_t valueLength);
+
+    size_t writeCompressedPair(const Header* header, std::ostream& output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
+    size_t writeCompressedPair(const Header* header, uint8_t* output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
+
+    size_t readCompressedValue(const Header* header, const uint8_t* input, uint8_t* value, size_t* valueLength);
+    size_t readCompressedValue(const Header* header, std::istream& input, std::ostream& value);
+}
+
+#endif
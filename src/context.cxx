@@ -0,0 +1,242 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "context.hxx"
+#include "metrics.hxx"
+
+#include <stdexcept>
+
+BDP::Context::Context() : Context(DEFAULT_CONTEXT_BUFFER_SIZE) { }
+
+BDP::Context::Context(size_t bufferSize) : header(),
+                                           buffer(),
+                                           bufferSize(bufferSize) {
+    if(bufferSize == 0u)
+        throw std::invalid_argument("bufferSize");
+
+    // The only allocation; every operation reuses this buffer.
+    buffer = std::make_unique<uint8_t[]>(bufferSize);
+}
+
+const BDP::Header& BDP::Context::writeHeader(std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
+    BDP_TIME(WRITE_HEADER);
+    uint8_t bytes[HEADER_LENGTH];
+    encodeHeader(bytes, nameLengthBitSize, valueLengthBitSize);
+
+    output.write((char*) (&bytes[0]), HEADER_LENGTH);
+
+    return header.emplace(nameLengthBitSize, valueLengthBitSize);
+}
+const BDP::Header& BDP::Context::writeHeader(uint8_t* output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
+    BDP_TIME(WRITE_HEADER);
+    encodeHeader(output, nameLengthBitSize, valueLengthBitSize);
+
+    return header.emplace(nameLengthBitSize, valueLengthBitSize);
+}
+
+const BDP::Header& BDP::Context::readHeader(std::istream& input) {
+    BDP_TIME(READ_HEADER);
+    uint8_t bytes[HEADER_LENGTH];
+    input.read((char*) (&bytes[0]), HEADER_LENGTH);
+
+    if(static_cast<size_t>(input.gcount()) != HEADER_LENGTH)
+        throw std::invalid_argument("input");
+
+    return header.emplace(decodeHeader(bytes));
+}
+const BDP::Header& BDP::Context::readHeader(const uint8_t* input) {
+    BDP_TIME(READ_HEADER);
+    return header.emplace(decodeHeader(input));
+}
+
+const BDP::Header& BDP::Context::setHeader(uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
+    // Validate the length bit sizes the same way writeHeader does.
+    uint8_t bytes[HEADER_LENGTH];
+    encodeHeader(bytes, nameLengthBitSize, valueLengthBitSize);
+
+    return header.emplace(nameLengthBitSize, valueLengthBitSize);
+}
+
+const BDP::Header& BDP::Context::getHeader() const {
+    if(!header)
+        throw std::runtime_error("context: No package header has been read or written");
+
+    return *header;
+}
+
+size_t BDP::Context::writeName(std::ostream& output, const uint8_t* name, size_t nameLength) {
+    return BDP::writeName(&getHeader(), output, name, nameLength);
+}
+size_t BDP::Context::writeName(uint8_t* output, const uint8_t* name, size_t nameLength) {
+    return BDP::writeName(&getHeader(), output, name, nameLength);
+}
+size_t BDP::Context::writeName(std::ostream& output, std::istream& name) {
+    const Header& current = getHeader();
+    return writeData(current.NAME_MAX_LENGTH, current.NAME_LENGTH_BYTE_SIZE, output, name, buffer.get(), bufferSize);
+}
+size_t BDP::Context::writeName(uint8_t* output, std::istream& name) {
+    return BDP::writeName(&getHeader(), output, name, bufferSize);
+}
+size_t BDP::Context::writeSizedName(std::ostream& output, std::istream& name, size_t nameLength) {
+    const Header& current = getHeader();
+    return writeSizedData(current.NAME_MAX_LENGTH, current.NAME_LENGTH_BYTE_SIZE, output, name, nameLength, buffer.get(), bufferSize);
+}
+
+size_t BDP::Context::writeValue(std::ostream& output, const uint8_t* value, size_t valueLength) {
+    return BDP::writeValue(&getHeader(), output, value, valueLength);
+}
+size_t BDP::Context::writeValue(uint8_t* output, const uint8_t* value, size_t valueLength) {
+    return BDP::writeValue(&getHeader(), output, value, valueLength);
+}
+size_t BDP::Context::writeValue(std::ostream& output, std::istream& value) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
+    const Header& current = getHeader();
+    return writeData(current.VALUE_MAX_LENGTH, current.VALUE_LENGTH_BYTE_SIZE, output, value, buffer.get(), bufferSize);
+}
+size_t BDP::Context::writeValue(uint8_t* output, std::istream& value) {
+    return BDP::writeValue(&getHeader(), output, value, bufferSize);
+}
+size_t BDP::Context::writeSizedValue(std::ostream& output, std::istream& value, size_t valueLength) {
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+
+    const Header& current = getHeader();
+    return writeSizedData(current.VALUE_MAX_LENGTH, current.VALUE_LENGTH_BYTE_SIZE, output, value, valueLength, buffer.get(), bufferSize);
+}
+
+size_t BDP::Context::writePair(std::ostream& output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+    size_t count = writeName(output, name, nameLength);
+    return count + writeValue(output, value, valueLength);
+}
+size_t BDP::Context::writePair(uint8_t* output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+    size_t count = writeName(output, name, nameLength);
+    return count + writeValue(output + count, value, valueLength);
+}
+size_t BDP::Context::writePair(std::ostream& output, const uint8_t* name, size_t nameLength, std::istream& value) {
+    size_t count = writeName(output, name, nameLength);
+    return count + writeValue(output, value);
+}
+size_t BDP::Context::writePair(uint8_t* output, const uint8_t* name, size_t nameLength, std::istream& value) {
+    size_t count = writeName(output, name, nameLength);
+    return count + writeValue(output + count, value);
+}
+size_t BDP::Context::writePair(std::ostream& output, std::istream& name, const uint8_t* value, size_t valueLength) {
+    size_t count = writeName(output, name);
+    return count + writeValue(output, value, valueLength);
+}
+size_t BDP::Context::writePair(uint8_t* output, std::istream& name, const uint8_t* value, size_t valueLength) {
+    size_t count = writeName(output, name);
+    return count + writeValue(output + count, value, valueLength);
+}
+size_t BDP::Context::writePair(std::ostream& output, std::istream& name, std::istream& value) {
+    size_t count = writeName(output, name);
+    return count + writeValue(output, value);
+}
+size_t BDP::Context::writePair(uint8_t* output, std::istream& name, std::istream& value) {
+    size_t count = writeName(output, name);
+    return count + writeValue(output + count, value);
+}
+
+size_t BDP::Context::readName(std::istream& input, uint8_t* name, size_t* nameLength) {
+    return BDP::readName(&getHeader(), input, name, nameLength);
+}
+size_t BDP::Context::readName(const uint8_t* input, uint8_t* name, size_t* nameLength) {
+    return BDP::readName(&getHeader(), input, name, nameLength);
+}
+size_t BDP::Context::readName(std::istream& input, std::ostream& name) {
+    return readData(getHeader().NAME_LENGTH_BYTE_SIZE, input, name, buffer.get(), bufferSize);
+}
+size_t BDP::Context::readName(const uint8_t* input, std::ostream& name, size_t* nameLength) {
+    return BDP::readName(&getHeader(), input, name, nameLength);
+}
+
+size_t BDP::Context::readValue(std::istream& input, uint8_t* value, size_t* valueLength) {
+    return BDP::readValue(&getHeader(), input, value, valueLength);
+}
+size_t BDP::Context::readValue(const uint8_t* input, uint8_t* value, size_t* valueLength) {
+    return BDP::readValue(&getHeader(), input, value, valueLength);
+}
+size_t BDP::Context::readValue(std::istream& input, std::ostream& value) {
+    BDP_COUNT(PAIRS_READ, 1u);
+
+    return readData(getHeader().VALUE_LENGTH_BYTE_SIZE, input, value, buffer.get(), bufferSize);
+}
+size_t BDP::Context::readValue(const uint8_t* input, std::ostream& value, size_t* valueLength) {
+    return BDP::readValue(&getHeader(), input, value, valueLength);
+}
+
+size_t BDP::Context::readPair(std::istream& input, uint8_t* name, size_t* nameLength, uint8_t* value, size_t* valueLength) {
+    size_t count = readName(input, name, nameLength);
+    return count + readValue(input, value, valueLength);
+}
+size_t BDP::Context::readPair(const uint8_t* input, uint8_t* name, size_t* nameLength, uint8_t* value, size_t* valueLength) {
+    size_t count = readName(input, name, nameLength);
+    return count + readValue(input + count, value, valueLength);
+}
+size_t BDP::Context::readPair(std::istream& input, uint8_t* name, size_t* nameLength, std::ostream& value) {
+    size_t count = readName(input, name, nameLength);
+    return count + readValue(input, value);
+}
+size_t BDP::Context::readPair(const uint8_t* input, uint8_t* name, size_t* nameLength, std::ostream& value, size_t* valueLength) {
+    size_t count = readName(input, name, nameLength);
+    return count + readValue(input + count, value, valueLength);
+}
+size_t BDP::Context::readPair(std::istream& input, std::ostream& name, uint8_t* value, size_t* valueLength) {
+    size_t count = readName(input, name);
+    return count + readValue(input, value, valueLength);
+}
+size_t BDP::Context::readPair(const uint8_t* input, std::ostream& name, size_t* nameLength, uint8_t* value, size_t* valueLength) {
+    size_t count = readName(input, name, nameLength);
+    return count + readValue(input + count, value, valueLength);
+}
+size_t BDP::Context::readPair(std::istream& input, std::ostream& name, std::ostream& value) {
+    size_t count = readName(input, name);
+    return count + readValue(input, value);
+}
+size_t BDP::Context::readPair(const uint8_t* input, std::ostream& name, size_t* nameLength, std::ostream& value, size_t* valueLength) {
+    size_t count = readName(input, name, nameLength);
+    return count + readValue(input + count, value, valueLength);
+}
+
+size_t BDP::Context::skipName(std::istream& input) {
+    return BDP::skipName(&getHeader(), input);
+}
+size_t BDP::Context::skipName(const uint8_t* input) {
+    return BDP::skipName(&getHeader(), input);
+}
+
+size_t BDP::Context::skipValue(std::istream& input) {
+    return BDP::skipValue(&getHeader(), input);
+}
+size_t BDP::Context::skipValue(const uint8_t* input) {
+    return BDP::skipValue(&getHeader(), input);
+}
+
+size_t BDP::Context::skipPair(std::istream& input) {
+    size_t count = skipName(input);
+    return count + skipValue(input);
+}
+size_t BDP::Context::skipPair(const uint8_t* input) {
+    size_t count = skipName(input);
+    return count + skipValue(input + count);
+}
@@ -0,0 +1,118 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_CONTEXT_HXX_INCLUDED
+#define BDP_CONTEXT_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+namespace BDP {
+    /// The default size of the scratch buffer owned by a context.
+    const size_t DEFAULT_CONTEXT_BUFFER_SIZE = 16384u;
+
+    class Context {
+    public:
+        Context();
+        explicit Context(size_t bufferSize);
+
+        Context(const Context&) = delete;
+        Context& operator=(const Context&) = delete;
+
+        Context(Context&&) noexcept = default;
+
+        const Header& writeHeader(std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize);
+        const Header& writeHeader(uint8_t* output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize);
+
+        const Header& readHeader(std::istream& input);
+        const Header& readHeader(const uint8_t* input);
+
+        const Header& setHeader(uint8_t nameLengthBitSize, uint8_t valueLengthBitSize);
+
+        bool hasHeader() const { return header.has_value(); }
+        const Header& getHeader() const;
+
+        uint8_t* getBuffer() { return buffer.get(); }
+        size_t getBufferSize() const { return bufferSize; }
+
+        size_t writeName(std::ostream& output, const uint8_t* name, size_t nameLength);
+        size_t writeName(uint8_t* output, const uint8_t* name, size_t nameLength);
+        size_t writeName(std::ostream& output, std::istream& name);
+        size_t writeName(uint8_t* output, std::istream& name);
+        size_t writeSizedName(std::ostream& output, std::istream& name, size_t nameLength);
+
+        size_t writeValue(std::ostream& output, const uint8_t* value, size_t valueLength);
+        size_t writeValue(uint8_t* output, const uint8_t* value, size_t valueLength);
+        size_t writeValue(std::ostream& output, std::istream& value);
+        size_t writeValue(uint8_t* output, std::istream& value);
+        size_t writeSizedValue(std::ostream& output, std::istream& value, size_t valueLength);
+
+        size_t writePair(std::ostream& output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
+        size_t writePair(uint8_t* output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
+        size_t writePair(std::ostream& output, const uint8_t* name, size_t nameLength, std::istream& value);
+        size_t writePair(uint8_t* output, const uint8_t* name, size_t nameLength, std::istream& value);
+        size_t writePair(std::ostream& output, std::istream& name, const uint8_t* value, size_t valueLength);
+        size_t writePair(uint8_t* output, std::istream& name, const uint8_t* value, size_t valueLength);
+        size_t writePair(std::ostream& output, std::istream& name, std::istream& value);
+        size_t writePair(uint8_t* output, std::istream& name, std::istream& value);
+
+        size_t readName(std::istream& input, uint8_t* name, size_t* nameLength);
+        size_t readName(const uint8_t* input, uint8_t* name, size_t* nameLength);
+        size_t readName(std::istream& input, std::ostream& name);
+        size_t readName(const uint8_t* input, std::ostream& name, size_t* nameLength);
+
+        size_t readValue(std::istream& input, uint8_t* value, size_t* valueLength);
+        size_t readValue(const uint8_t* input, uint8_t* value, size_t* valueLength);
+        size_t readValue(std::istream& input, std::ostream& value);
+        size_t readValue(const uint8_t* input, std::ostream& value, size_t* valueLength);
+
+        size_t readPair(std::istream& input, uint8_t* name, size_t* nameLength, uint8_t* value, size_t* valueLength);
+        size_t readPair(const uint8_t* input, uint8_t* name, size_t* nameLength, uint8_t* value, size_t* valueLength);
+        size_t readPair(std::istream& input, uint8_t* name, size_t* nameLength, std::ostream& value);
+        size_t readPair(const uint8_t* input, uint8_t* name, size_t* nameLength, std::ostream& value, size_t* valueLength);
+        size_t readPair(std::istream& input, std::ostream& name, uint8_t* value, size_t* valueLength);
+        size_t readPair(const uint8_t* input, std::ostream& name, size_t* nameLength, uint8_t* value, size_t* valueLength);
+        size_t readPair(std::istream& input, std::ostream& name, std::ostream& value);
+        size_t readPair(const uint8_t* input, std::ostream& name, size_t* nameLength, std::ostream& value, size_t* valueLength);
+
+        size_t skipName(std::istream& input);
+        size_t skipName(const uint8_t* input);
+
+        size_t skipValue(std::istream& input);
+        size_t skipValue(const uint8_t* input);
+
+        size_t skipPair(std::istream& input);
+        size_t skipPair(const uint8_t* input);
+
+    private:
+        std::optional<Header> header;
+
+        std::unique_ptr<uint8_t[]> buffer;
+        size_t bufferSize;
+    };
+}
+
+#endif
@@ -0,0 +1,378 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "dictionary.hxx"
+#include "checksum.hxx"
+#include "metrics.hxx"
+
+#include <stdexcept>
+
+/// The largest part of a name which is read from a stream at once, so a corrupt length can't allocate more than the stream holds.
+const size_t DICTIONARY_NAME_CHUNK_SIZE = 65536u;
+
+void checkDictionaryHeader(const BDP::Header* header) {
+    if((header->FLAGS & BDP::HEADER_FLAG_NAME_DICTIONARY) == 0u)
+        throw std::invalid_argument("header: The package doesn't have a name dictionary");
+    // The dictionary functions store values as they are given.
+    if((header->FLAGS & BDP::HEADER_FLAG_COMPRESSED) != 0u)
+        throw std::invalid_argument("header: Packages with a name dictionary can't be compressed");
+}
+
+size_t getNameMarkerLength(size_t marker) {
+    size_t length = 1u;
+
+    for(; marker >= 0x80u; marker >>= 7u)
+        ++length;
+
+    return length;
+}
+
+void readDictionaryBytes(std::istream& input, uint8_t* output, size_t length, const char* error) {
+    input.read(reinterpret_cast<char*>(output), static_cast<std::streamsize>(length));
+
+    if(static_cast<size_t>(input.gcount()) != length)
+        throw std::runtime_error(error);
+
+    BDP_COUNT(STREAM_READS, 1u);
+}
+
+// The name grows as its bytes arrive, instead of being allocated from the length up front.
+void readDictionaryName(std::istream& input, std::string& name, size_t nameLength) {
+    name.clear();
+
+    while(name.size() < nameLength) {
+        size_t offset = name.size();
+        size_t chunkLength = nameLength - offset < DICTIONARY_NAME_CHUNK_SIZE ? nameLength - offset : DICTIONARY_NAME_CHUNK_SIZE;
+
+        name.resize(offset + chunkLength);
+        readDictionaryBytes(input, reinterpret_cast<uint8_t*>(&name[offset]), chunkLength, "input: Truncated name");
+    }
+}
+
+size_t BDP::writeNameMarker(uint8_t* output, size_t marker) {
+    size_t count = 0u;
+
+    for(; marker >= 0x80u; marker >>= 7u)
+        output[count++] = static_cast<uint8_t>((marker & 0x7Fu) | 0x80u);
+
+    output[count++] = static_cast<uint8_t>(marker);
+
+    return count;
+}
+
+// Returns 0 if the marker is truncated or too long.
+size_t BDP::readNameMarker(const uint8_t* input, size_t inputLength, size_t* marker) {
+    size_t value = 0u;
+
+    for(size_t i = 0u; i < inputLength && i < NAME_MARKER_MAX_LENGTH; ++i) {
+        size_t bits = static_cast<size_t>(input[i] & 0x7Fu);
+
+        if(i * 7u >= sizeof(size_t) * 8u || (bits << (i * 7u)) >> (i * 7u) != bits)
+            return 0u;
+
+        value |= bits << (i * 7u);
+
+        if((input[i] & 0x80u) == 0u) {
+            *marker = value;
+            return i + 1u;
+        }
+    }
+
+    return 0u;
+}
+
+BDP::NameDictionary::NameDictionary() : NameDictionary(DEFAULT_NAME_DICTIONARY_CAPACITY) { }
+
+BDP::NameDictionary::NameDictionary(size_t capacity) : capacity(capacity), entries(), indices(), storage(), literal() { }
+
+std::string_view BDP::NameDictionary::getEntry(size_t index) const {
+    if(index >= entries.size())
+        throw std::invalid_argument("index");
+
+    return entries[index];
+}
+
+void BDP::NameDictionary::clear() {
+    entries.clear();
+    indices.clear();
+    storage.clear();
+    literal.clear();
+}
+
+// Writes the name marker, and the name length if the name follows it. A reference is only used
+// if it isn't longer than the full name, so a pair is at most one byte longer than a plain pair.
+size_t BDP::NameDictionary::encodeNameEntry(const Header* header, uint8_t* output, const uint8_t* name, size_t nameLength, bool* nameFollows) {
+    std::string_view key(reinterpret_cast<const char*>(name), nameLength);
+    size_t literalLength = 1u + header->NAME_LENGTH_BYTE_SIZE + nameLength;
+    size_t marker = NAME_MARKER_LITERAL;
+
+    auto found = indices.find(key);
+
+    if(found != indices.end()) {
+        size_t reference = found->second + NAME_MARKER_FIRST_REFERENCE;
+
+        if(getNameMarkerLength(reference) <= literalLength) {
+            *nameFollows = false;
+            return writeNameMarker(output, reference);
+        }
+    } else if(entries.size() < capacity) {
+        storage.emplace_back(key);
+        entries.push_back(storage.back());
+        indices.emplace(storage.back(), entries.size() - 1u);
+
+        marker = NAME_MARKER_DEFINITION;
+    }
+
+    size_t count = writeNameMarker(output, marker);
+    lengthToBytes(output + count, nameLength, header->NAME_LENGTH_BYTE_SIZE);
+
+    *nameFollows = true;
+    return count + header->NAME_LENGTH_BYTE_SIZE;
+}
+
+size_t BDP::NameDictionary::writePair(const Header* header, std::ostream& output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+    checkDictionaryHeader(header);
+
+    if(nameLength > header->NAME_MAX_LENGTH)
+        throw std::invalid_argument("nameLength");
+    if(valueLength > header->VALUE_MAX_LENGTH)
+        throw std::invalid_argument("valueLength");
+
+    uint8_t prefix[NAME_MARKER_MAX_LENGTH + sizeof(uint64_t)];
+    uint8_t valuePrefix[sizeof(uint64_t)];
+    bool nameFollows;
+
+    size_t prefixLength = encodeNameEntry(header, prefix, name, nameLength, &nameFollows);
+    lengthToBytes(valuePrefix, valueLength, header->VALUE_LENGTH_BYTE_SIZE);
+
+    if(!nameFollows)
+        nameLength = 0u;
+
+    output.write(reinterpret_cast<const char*>(prefix), static_cast<std::streamsize>(prefixLength));
+    output.write(reinterpret_cast<const char*>(name), static_cast<std::streamsize>(nameLength));
+    output.write(reinterpret_cast<const char*>(valuePrefix), header->VALUE_LENGTH_BYTE_SIZE);
+    output.write(reinterpret_cast<const char*>(value), static_cast<std::streamsize>(valueLength));
+
+    size_t count = prefixLength + nameLength + header->VALUE_LENGTH_BYTE_SIZE + valueLength;
+
+    if((header->FLAGS & HEADER_FLAG_CHECKSUMMED) != 0u) {
+        uint32_t crc = crc32c(prefix, prefixLength);
+        crc = crc32c(crc, name, nameLength);
+        crc = crc32c(crc, valuePrefix, header->VALUE_LENGTH_BYTE_SIZE);
+        crc = crc32c(crc, value, valueLength);
+
+        uint8_t trailer[CHECKSUM_LENGTH];
+        lengthToBytes(trailer, crc, CHECKSUM_LENGTH);
+
+        output.write(reinterpret_cast<const char*>(trailer), CHECKSUM_LENGTH);
+        count += CHECKSUM_LENGTH;
+    }
+
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+    BDP_COUNT(BYTES_WRITTEN, count);
+    BDP_COUNT(STREAM_WRITES, 4u);
+
+    return count;
+}
+
+size_t BDP::NameDictionary::writePair(const Header* header, uint8_t* output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+    checkDictionaryHeader(header);
+
+    if(nameLength > header->NAME_MAX_LENGTH)
+        throw std::invalid_argument("nameLength");
+    if(valueLength > header->VALUE_MAX_LENGTH)
+        throw std::invalid_argument("valueLength");
+
+    bool nameFollows;
+    size_t count = encodeNameEntry(header, output, name, nameLength, &nameFollows);
+
+    if(nameFollows) {
+        memcpy(output + count, name, nameLength);
+        count += nameLength;
+    }
+
+    lengthToBytes(output + count, valueLength, header->VALUE_LENGTH_BYTE_SIZE);
+    count += header->VALUE_LENGTH_BYTE_SIZE;
+
+    memcpy(output + count, value, valueLength);
+    count += valueLength;
+
+    if((header->FLAGS & HEADER_FLAG_CHECKSUMMED) != 0u) {
+        lengthToBytes(output + count, crc32c(output, count), CHECKSUM_LENGTH);
+        count += CHECKSUM_LENGTH;
+    }
+
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+    BDP_COUNT(BYTES_WRITTEN, count);
+
+    return count;
+}
+
+// The names are views into the input, or into the dictionary for references; nothing is copied.
+size_t BDP::NameDictionary::readPair(const Header* header, const uint8_t* input, std::string_view* name, std::string_view* value) {
+    checkDictionaryHeader(header);
+
+    size_t marker;
+    size_t count = readNameMarker(input, NAME_MARKER_MAX_LENGTH, &marker);
+
+    if(count == 0u)
+        throw std::runtime_error("input: Invalid name marker");
+
+    if(marker >= NAME_MARKER_FIRST_REFERENCE) {
+        if(marker - NAME_MARKER_FIRST_REFERENCE >= entries.size())
+            throw std::runtime_error("input: Invalid name reference");
+
+        *name = entries[marker - NAME_MARKER_FIRST_REFERENCE];
+    } else {
+        size_t nameLength = 0u;
+
+        bytesToLength(nameLength, input + count, header->NAME_LENGTH_BYTE_SIZE);
+        count += header->NAME_LENGTH_BYTE_SIZE;
+
+        *name = std::string_view(reinterpret_cast<const char*>(input + count), nameLength);
+        count += nameLength;
+
+        if(marker == NAME_MARKER_DEFINITION)
+            entries.push_back(*name);
+    }
+
+    size_t valueLength = 0u;
+
+    bytesToLength(valueLength, input + count, header->VALUE_LENGTH_BYTE_SIZE);
+    count += header->VALUE_LENGTH_BYTE_SIZE;
+
+    *value = std::string_view(reinterpret_cast<const char*>(input + count), valueLength);
+    count += valueLength;
+
+    if((header->FLAGS & HEADER_FLAG_CHECKSUMMED) != 0u) {
+        size_t checksum = 0u;
+        bytesToLength(checksum, input + count, CHECKSUM_LENGTH);
+
+        if(checksum != crc32c(input, count))
+            throw std::runtime_error("input: Checksum mismatch");
+
+        count += CHECKSUM_LENGTH;
+    }
+
+    BDP_COUNT(PAIRS_READ, 1u);
+    BDP_COUNT(BYTES_READ, count);
+
+    return count;
+}
+
+// Defined names are copied into the dictionary once; references and literals are views which
+// are valid until the next pair is read.
+size_t BDP::NameDictionary::readPair(const Header* header, std::istream& input, std::string_view* name, uint8_t* value, size_t valueCapacity, size_t* valueLength) {
+    checkDictionaryHeader(header);
+
+    uint8_t prefix[NAME_MARKER_MAX_LENGTH + sizeof(uint64_t)];
+    size_t prefixLength = 0u;
+
+    do {
+        readDictionaryBytes(input, prefix + prefixLength, 1u, "input: Truncated name marker");
+        ++prefixLength;
+    } while((prefix[prefixLength - 1u] & 0x80u) != 0u && prefixLength < NAME_MARKER_MAX_LENGTH);
+
+    size_t marker;
+
+    if(readNameMarker(prefix, prefixLength, &marker) == 0u)
+        throw std::runtime_error("input: Invalid name marker");
+
+    bool checksummed = (header->FLAGS & HEADER_FLAG_CHECKSUMMED) != 0u;
+    uint32_t crc = 0u;
+
+    if(marker >= NAME_MARKER_FIRST_REFERENCE) {
+        if(marker - NAME_MARKER_FIRST_REFERENCE >= entries.size())
+            throw std::runtime_error("input: Invalid name reference");
+
+        *name = entries[marker - NAME_MARKER_FIRST_REFERENCE];
+
+        if(checksummed)
+            crc = crc32c(prefix, prefixLength);
+    } else {
+        size_t nameLength = 0u;
+
+        readDictionaryBytes(input, prefix + prefixLength, header->NAME_LENGTH_BYTE_SIZE, "input: Truncated name length");
+        bytesToLength(nameLength, prefix + prefixLength, header->NAME_LENGTH_BYTE_SIZE);
+        prefixLength += header->NAME_LENGTH_BYTE_SIZE;
+
+        if(marker == NAME_MARKER_DEFINITION) {
+            storage.emplace_back();
+
+            try {
+                readDictionaryName(input, storage.back(), nameLength);
+            } catch(...) {
+                storage.pop_back();
+                throw;
+            }
+
+            entries.push_back(storage.back());
+        } else {
+            readDictionaryName(input, literal, nameLength);
+        }
+
+        *name = marker == NAME_MARKER_DEFINITION ? std::string_view(storage.back()) : std::string_view(literal);
+
+        if(checksummed) {
+            crc = crc32c(prefix, prefixLength);
+            crc = crc32c(crc, reinterpret_cast<const uint8_t*>(name->data()), name->size());
+        }
+    }
+
+    uint8_t valuePrefix[sizeof(uint64_t)];
+    size_t length = 0u;
+
+    readDictionaryBytes(input, valuePrefix, header->VALUE_LENGTH_BYTE_SIZE, "input: Truncated value length");
+    bytesToLength(length, valuePrefix, header->VALUE_LENGTH_BYTE_SIZE);
+
+    // The length comes from the input, so it is checked before anything is written to the buffer.
+    if(length > valueCapacity)
+        throw std::runtime_error("input: The value is longer than valueCapacity");
+
+    readDictionaryBytes(input, value, length, "input: Truncated value");
+
+    size_t count = prefixLength + (marker >= NAME_MARKER_FIRST_REFERENCE ? 0u : name->size()) + header->VALUE_LENGTH_BYTE_SIZE + length;
+
+    if(checksummed) {
+        crc = crc32c(crc, valuePrefix, header->VALUE_LENGTH_BYTE_SIZE);
+        crc = crc32c(crc, value, length);
+
+        uint8_t trailer[CHECKSUM_LENGTH];
+        size_t checksum = 0u;
+
+        readDictionaryBytes(input, trailer, CHECKSUM_LENGTH, "input: Truncated checksum");
+        bytesToLength(checksum, trailer, CHECKSUM_LENGTH);
+
+        if(checksum != crc)
+            throw std::runtime_error("input: Checksum mismatch");
+
+        count += CHECKSUM_LENGTH;
+    }
+
+    if(valueLength != nullptr)
+        *valueLength = length;
+
+    BDP_COUNT(PAIRS_READ, 1u);
+    BDP_COUNT(BYTES_READ, count);
+
+    return count;
+}
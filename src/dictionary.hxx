@@ -0,0 +1,88 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BDP_DICTIONARY_HXX_INCLUDED
+#define BDP_DICTIONARY_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace BDP {
+    /// The default number of names which a NameDictionary defines. New names after that are stored in full.
+    const size_t DEFAULT_NAME_DICTIONARY_CAPACITY = 65536u;
+
+    /// The name is stored in full, and is not added to the dictionary.
+    const size_t NAME_MARKER_LITERAL = 0u;
+    /// The name is stored in full, and becomes the next dictionary entry.
+    const size_t NAME_MARKER_DEFINITION = 1u;
+    /// Markers from this value on refer to the dictionary entry (marker - NAME_MARKER_FIRST_REFERENCE).
+    const size_t NAME_MARKER_FIRST_REFERENCE = 2u;
+    /// The maximum length of an encoded name marker.
+    const size_t NAME_MARKER_MAX_LENGTH = 10u;
+
+    size_t writeNameMarker(uint8_t* output, size_t marker);
+    size_t readNameMarker(const uint8_t* input, size_t inputLength, size_t* marker);
+
+    class NameDictionary {
+    public:
+        NameDictionary();
+        explicit NameDictionary(size_t capacity);
+
+        NameDictionary(const NameDictionary&) = delete;
+        NameDictionary& operator=(const NameDictionary&) = delete;
+
+        size_t writePair(const Header* header, std::ostream& output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
+        size_t writePair(const Header* header, uint8_t* output, const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
+
+        size_t readPair(const Header* header, const uint8_t* input, std::string_view* name, std::string_view* value);
+        size_t readPair(const Header* header, std::istream& input, std::string_view* name, uint8_t* value, size_t valueCapacity, size_t* valueLength);
+
+        size_t getCapacity() const { return capacity; }
+        size_t getEntryCount() const { return entries.size(); }
+        std::string_view getEntry(size_t index) const;
+
+        void clear();
+
+    private:
+        size_t encodeNameEntry(const Header* header, uint8_t* output, const uint8_t* name, size_t nameLength, bool* nameFollows);
+
+        size_t capacity;
+
+        std::vector<std::string_view> entries;
+        std::unordered_map<std::string_view, size_t> indices;
+
+        // Names which are defined while writing, or read from a stream, are copied here once.
+        std::deque<std::string> storage;
+        std::string literal;
+    };
+}
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_HASH_HXX_INCLUDED
+#define BDP_HASH_HXX_INCLUDED
+
+#include "codec.hxx"
+
+#include <cstdint>
+#include <cstring>
+
+namespace BDP {
+    inline uint64_t readLittleEndian64(const uint8_t* source) {
+        uint64_t value;
+        memcpy(&value, source, sizeof(value));
+
+        if constexpr(!NATIVE_LITTLE_ENDIAN) {
+            uint64_t swapped = 0u;
+
+            for(uint8_t i = 0u; i < sizeof(value); ++i, value >>= 8u)
+                swapped = (swapped << 8u) | (value & 0xFFu);
+
+            value = swapped;
+        }
+
+        return value;
+    }
+
+    inline void writeLittleEndian64(uint8_t* destination, uint64_t value) {
+        for(uint8_t i = 0u; i < sizeof(value); ++i, value >>= 8u)
+            destination[i] = static_cast<uint8_t>(value & 0xFFu);
+    }
+
+    inline uint64_t mixHash(uint64_t value) {
+        value ^= value >> 33u;
+        value *= 0xFF51AFD7ED558CCDull;
+        value ^= value >> 33u;
+        value *= 0xC4CEB9FE1A85EC53ull;
+        value ^= value >> 33u;
+
+        return value;
+    }
+
+    // Processes 8 bytes at a time. The result doesn't depend on the architecture,
+    // so it can be stored in files (e.g. package indexes).
+    inline uint64_t hashName(const uint8_t* name, size_t nameLength) {
+        uint64_t hash = 0x9E3779B97F4A7C15ull ^ (static_cast<uint64_t>(nameLength) * 0xCBF29CE484222325ull);
+        size_t remaining = nameLength;
+
+        for(; remaining >= 8u; remaining -= 8u, name += 8u) {
+            hash ^= mixHash(readLittleEndian64(name));
+            hash = ((hash << 27u) | (hash >> 37u)) * 5u + 0x52DCE729u;
+        }
+
+        if(remaining > 0u) {
+            uint64_t tail = 0u;
+
+            for(size_t i = 0u; i < remaining; ++i)
+                tail |= static_cast<uint64_t>(name[i]) << (8u * i);
+
+            hash ^= mixHash(tail);
+            hash = ((hash << 27u) | (hash >> 37u)) * 5u + 0x52DCE729u;
+        }
+
+        return mixHash(hash);
+    }
+}
+
+#endif
@@ -0,0 +1,266 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "index.hxx"
+#include "hash.hxx"
+
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+/// The magic index value, which is located at the beginning of every index file.
+const char* INDEX_MAGIC_VALUE = "BDPI";
+/// The magic index value length.
+const uint8_t INDEX_MAGIC_VALUE_LENGTH = 4u;
+/// The index format version.
+const uint8_t INDEX_VERSION = 1u;
+/// The default size of the buffer used to copy values from the package.
+const size_t INDEX_BUFFER_SIZE = 16384u;
+
+/*
+ * Index layout (all integers are 64-bit little-endian):
+ *
+ *   [BDPI][version][package header byte][2 reserved bytes][slot count][entry count][package length]
+ *   [slot]*
+ *
+ *   slot = [name hash][pair offset][name length][value length]
+ *
+ * Empty slots have a pair offset of 0, which is never a valid offset because of the package header.
+ */
+
+uint8_t* getIndexSlot(std::vector<uint8_t>& index, size_t slot) {
+    return index.data() + BDP::INDEX_HEADER_LENGTH + slot * BDP::INDEX_SLOT_LENGTH;
+}
+
+void readIndexSlot(const uint8_t* slot, BDP::IndexEntry& entry) {
+    entry.hash = BDP::readLittleEndian64(slot);
+    entry.pairOffset = static_cast<size_t>(BDP::readLittleEndian64(slot + 8u));
+    entry.nameLength = static_cast<size_t>(BDP::readLittleEndian64(slot + 16u));
+    entry.valueLength = static_cast<size_t>(BDP::readLittleEndian64(slot + 24u));
+}
+
+size_t BDP::buildIndex(const PackageView& package, std::ostream& index) {
+    const Header& header = package.getHeader();
+    const uint8_t* data = package.getData();
+
+    size_t count = 0u;
+    for(auto it = package.begin(); it != package.end(); ++it)
+        ++count;
+
+    // Keep the load factor at or below 0.7, so probe sequences stay short.
+    size_t slotCount = 1u;
+    while(slotCount * 7u < count * 10u)
+        slotCount <<= 1u;
+
+    size_t mask = slotCount - 1u;
+    size_t entries = 0u;
+
+    std::vector<uint8_t> buffer(INDEX_HEADER_LENGTH + slotCount * INDEX_SLOT_LENGTH, 0u);
+    IndexEntry entry;
+
+    for(auto it = package.begin(); it != package.end(); ++it) {
+        const PairView& pair = *it;
+        const uint8_t* name = reinterpret_cast<const uint8_t*>(pair.name.data());
+        uint64_t hash = hashName(name, pair.name.size());
+        size_t pairOffset = static_cast<size_t>(it.getPosition() - data);
+
+        size_t slot = static_cast<size_t>(hash) & mask;
+        uint8_t* slotData;
+
+        for(;; slot = (slot + 1u) & mask) {
+            slotData = getIndexSlot(buffer, slot);
+            readIndexSlot(slotData, entry);
+
+            if(entry.pairOffset == 0u) {
+                ++entries;
+                break;
+            }
+
+            // When a name appears more than once, the last pair wins.
+            if(entry.hash == hash && entry.nameLength == pair.name.size() &&
+               memcmp(data + entry.pairOffset + header.NAME_LENGTH_BYTE_SIZE, name, entry.nameLength) == 0)
+                break;
+        }
+
+        writeLittleEndian64(slotData, hash);
+        writeLittleEndian64(slotData + 8u, pairOffset);
+        writeLittleEndian64(slotData + 16u, pair.name.size());
+        writeLittleEndian64(slotData + 24u, pair.value.size());
+    }
+
+    memcpy(buffer.data(), INDEX_MAGIC_VALUE, INDEX_MAGIC_VALUE_LENGTH);
+    buffer[4u] = INDEX_VERSION;
+    buffer[5u] = static_cast<uint8_t>((header.NAME_LENGTH_BIT_SIZE << 1u) | (header.VALUE_LENGTH_BIT_SIZE >> 3u));
+
+    writeLittleEndian64(buffer.data() + 8u, slotCount);
+    writeLittleEndian64(buffer.data() + 16u, entries);
+    writeLittleEndian64(buffer.data() + 24u, package.getLength());
+
+    index.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+
+    return entries;
+}
+
+size_t BDP::buildIndex(const char* packagePath, const char* indexPath) {
+    MappedPackage package(packagePath);
+    std::ofstream index(indexPath, std::ios::binary | std::ios::trunc);
+
+    if(!index)
+        throw std::runtime_error("indexPath: Cannot open file");
+
+    size_t entries = buildIndex(package.getView(), index);
+
+    index.flush();
+    if(!index)
+        throw std::runtime_error("indexPath: Cannot write file");
+
+    return entries;
+}
+
+BDP::Header readIndexHeader(const BDP::MappedFile& file) {
+    const uint8_t* data = file.getData();
+
+    if(file.getLength() < BDP::INDEX_HEADER_LENGTH || memcmp(data, INDEX_MAGIC_VALUE, INDEX_MAGIC_VALUE_LENGTH) != 0)
+        throw std::invalid_argument("indexPath: Invalid index header");
+    if(data[4u] != INDEX_VERSION)
+        throw std::invalid_argument("indexPath: Unsupported index version");
+
+    uint64_t slotCount = BDP::readLittleEndian64(data + 8u);
+
+    if(slotCount == 0u || (slotCount & (slotCount - 1u)) != 0u ||
+       slotCount > (file.getLength() - BDP::INDEX_HEADER_LENGTH) / BDP::INDEX_SLOT_LENGTH ||
+       file.getLength() != BDP::INDEX_HEADER_LENGTH + slotCount * BDP::INDEX_SLOT_LENGTH)
+        throw std::invalid_argument("indexPath: Invalid index length");
+
+    // Reuse the package header parser for the stored header byte.
+    uint8_t packageHeader[BDP::HEADER_LENGTH] = { 'B', 'D', 'P', data[5u] };
+    return BDP::decodeHeader(packageHeader);
+}
+
+BDP::PackageIndex::PackageIndex(const char* indexPath) : file(indexPath, AccessPattern::RANDOM),
+                                                         header(readIndexHeader(file)),
+                                                         slots(file.getData() + INDEX_HEADER_LENGTH),
+                                                         slotMask(static_cast<size_t>(readLittleEndian64(file.getData() + 8u)) - 1u),
+                                                         entryCount(static_cast<size_t>(readLittleEndian64(file.getData() + 16u))),
+                                                         packageLength(static_cast<size_t>(readLittleEndian64(file.getData() + 24u))) { }
+
+// Finds the next slot, starting from the given one, which has the same hash and name length.
+// The remaining probe count guards against corrupted indexes which have no empty slots.
+bool BDP::PackageIndex::probe(uint64_t hash, size_t nameLength, size_t& slot, size_t& remaining, IndexEntry& entry) const {
+    for(; remaining > 0u; --remaining, slot = (slot + 1u) & slotMask) {
+        readIndexSlot(slots + slot * INDEX_SLOT_LENGTH, entry);
+
+        if(entry.pairOffset == 0u)
+            return false;
+
+        if(entry.hash == hash && entry.nameLength == nameLength) {
+            entry.valueOffset = entry.pairOffset + header.NAME_LENGTH_BYTE_SIZE + entry.nameLength + header.VALUE_LENGTH_BYTE_SIZE;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool BDP::PackageIndex::find(const PackageView& package, const uint8_t* name, size_t nameLength, PairView& pair) const {
+    if(package.getLength() != packageLength)
+        throw std::invalid_argument("package: The package doesn't match the index");
+
+    uint64_t hash = hashName(name, nameLength);
+    size_t slot = static_cast<size_t>(hash) & slotMask;
+    size_t remaining = slotMask + 1u;
+    IndexEntry entry;
+
+    for(; probe(hash, nameLength, slot, remaining, entry); --remaining, slot = (slot + 1u) & slotMask) {
+        // The entry is used to address the package directly, so a corrupted index must not point past it.
+        if(entry.pairOffset > packageLength ||
+           packageLength - entry.pairOffset < header.NAME_LENGTH_BYTE_SIZE + nameLength + header.VALUE_LENGTH_BYTE_SIZE ||
+           entry.valueLength > packageLength - entry.valueOffset)
+            throw std::runtime_error("index: Invalid index entry");
+
+        const uint8_t* entryName = package.getData() + entry.pairOffset + header.NAME_LENGTH_BYTE_SIZE;
+
+        if(memcmp(entryName, name, nameLength) == 0) {
+            pair.name = std::string_view(reinterpret_cast<const char*>(entryName), nameLength);
+            pair.value = std::string_view(reinterpret_cast<const char*>(package.getData() + entry.valueOffset), entry.valueLength);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool BDP::PackageIndex::find(std::istream& package, const uint8_t* name, size_t nameLength, std::ostream& value) const {
+    return find(package, name, nameLength, value, INDEX_BUFFER_SIZE);
+}
+
+bool BDP::PackageIndex::find(std::istream& package, const uint8_t* name, size_t nameLength, std::ostream& value, size_t bufferSize) const {
+    uint64_t hash = hashName(name, nameLength);
+    size_t slot = static_cast<size_t>(hash) & slotMask;
+    size_t remaining = slotMask + 1u;
+    IndexEntry entry;
+
+    std::unique_ptr<char[]> buffer;
+
+    for(; probe(hash, nameLength, slot, remaining, entry); --remaining, slot = (slot + 1u) & slotMask) {
+        // The hashes match, so the name and the value are read in one go from the pair offset.
+        if(!buffer)
+            buffer = std::make_unique<char[]>(bufferSize > nameLength ? bufferSize : nameLength);
+
+        package.clear();
+        package.seekg(static_cast<std::streamoff>(entry.pairOffset + header.NAME_LENGTH_BYTE_SIZE));
+        package.read(buffer.get(), nameLength);
+
+        if(static_cast<size_t>(package.gcount()) != nameLength)
+            throw std::runtime_error("package: The package doesn't match the index");
+
+        if(memcmp(buffer.get(), name, nameLength) != 0)
+            continue;
+
+        package.seekg(header.VALUE_LENGTH_BYTE_SIZE, std::ios::cur);
+
+        size_t length = entry.valueLength;
+        size_t nextLength;
+
+        while(length > 0u) {
+            nextLength = length < bufferSize ? length : bufferSize;
+            package.read(buffer.get(), nextLength);
+
+            // A stream which failed without reaching its end reads nothing, and never sets eofbit.
+            if(package.gcount() == 0)
+                break;
+
+            value.write(buffer.get(), package.gcount());
+            length -= static_cast<size_t>(package.gcount());
+        }
+
+        if(length != 0u)
+            throw std::runtime_error("package: The package doesn't match the index");
+
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,76 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_INDEX_HXX_INCLUDED
+#define BDP_INDEX_HXX_INCLUDED
+
+#include "bdp.hxx"
+#include "view.hxx"
+
+#include <istream>
+#include <ostream>
+
+namespace BDP {
+    /// The length of the index header, which precedes the slots.
+    const size_t INDEX_HEADER_LENGTH = 32u;
+    /// The length of an index slot.
+    const size_t INDEX_SLOT_LENGTH = 32u;
+
+    struct IndexEntry {
+        uint64_t hash;
+        size_t pairOffset;
+        size_t nameLength;
+        size_t valueLength;
+        size_t valueOffset;
+    };
+
+    size_t buildIndex(const PackageView& package, std::ostream& index);
+    size_t buildIndex(const char* packagePath, const char* indexPath);
+
+    class PackageIndex {
+    public:
+        explicit PackageIndex(const char* indexPath);
+
+        bool find(const PackageView& package, const uint8_t* name, size_t nameLength, PairView& pair) const;
+        bool find(std::istream& package, const uint8_t* name, size_t nameLength, std::ostream& value) const;
+        bool find(std::istream& package, const uint8_t* name, size_t nameLength, std::ostream& value, size_t bufferSize) const;
+
+        const Header& getHeader() const { return header; }
+        size_t getEntryCount() const { return entryCount; }
+        size_t getPackageLength() const { return packageLength; }
+
+    private:
+        bool probe(uint64_t hash, size_t nameLength, size_t& slot, size_t& remaining, IndexEntry& entry) const;
+
+        MappedFile file;
+        Header header;
+
+        const uint8_t* slots;
+        size_t slotMask;
+
+        size_t entryCount;
+        size_t packageLength;
+    };
+}
+
+#endif
@@ -0,0 +1,477 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "log.hxx"
+#include "checksum.hxx"
+#include "metrics.hxx"
+
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <fcntl.h>
+    #include <sys/types.h>
+    #include <unistd.h>
+#endif
+
+// The checkpoints are stored in a sidecar file, so the log itself stays a plain package. The sidecar has
+// two slots, which are written alternately; a torn checkpoint write only loses that checkpoint.
+const char* LOG_CHECKPOINT_MAGIC_VALUE = "BDPC";
+const char* LOG_CHECKPOINT_EXTENSION = ".ckpt";
+
+/// Magic value, sequence, length, pair count, and the checksum of the previous fields.
+const size_t LOG_CHECKPOINT_RECORD_LENGTH = 32u;
+const size_t LOG_CHECKPOINT_CHECKSUM_OFFSET = 28u;
+
+const size_t LOG_SCAN_BUFFER_SIZE = 65536u;
+
+struct LogCheckpoint {
+    uint64_t sequence;
+    uint64_t length;
+    uint64_t pairCount;
+};
+
+void seekLogFile(FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    int result = _fseeki64(file, static_cast<__int64>(offset), SEEK_SET);
+#else
+    int result = fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+
+    if(result != 0)
+        throw std::runtime_error("log: Cannot seek in the file");
+}
+
+void syncLogFile(FILE* file) {
+    if(fflush(file) != 0)
+        throw std::runtime_error("log: Cannot flush the file");
+
+#ifdef _WIN32
+    int result = _commit(_fileno(file));
+#else
+    int result = fsync(fileno(file));
+#endif
+
+    if(result != 0)
+        throw std::runtime_error("log: Cannot sync the file");
+}
+
+// A new file is only durable once its directory entry is.
+void syncLogDirectory(const char* path) {
+#ifndef _WIN32
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+    int fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+
+    if(fd == -1)
+        return;
+
+    fsync(fd);
+    close(fd);
+#else
+    (void) path;
+#endif
+}
+
+// The fields are little-endian, like the lengths of a package.
+void writeLogCheckpointField(uint8_t* output, uint64_t value) {
+    for(uint8_t i = 0u; i < 8u; ++i)
+        output[i] = static_cast<uint8_t>(value >> (8u * i));
+}
+
+uint64_t readLogCheckpointField(const uint8_t* input) {
+    uint64_t value = 0u;
+
+    for(uint8_t i = 0u; i < 8u; ++i)
+        value |= static_cast<uint64_t>(input[i]) << (8u * i);
+
+    return value;
+}
+
+void encodeLogCheckpoint(uint8_t* output, const LogCheckpoint& checkpoint) {
+    memcpy(output, LOG_CHECKPOINT_MAGIC_VALUE, 4u);
+
+    writeLogCheckpointField(output + 4u, checkpoint.sequence);
+    writeLogCheckpointField(output + 12u, checkpoint.length);
+    writeLogCheckpointField(output + 20u, checkpoint.pairCount);
+
+    BDP::lengthToBytes(output + LOG_CHECKPOINT_CHECKSUM_OFFSET, BDP::crc32c(output, LOG_CHECKPOINT_CHECKSUM_OFFSET), 4u);
+}
+
+bool decodeLogCheckpoint(const uint8_t* input, LogCheckpoint& checkpoint) {
+    if(memcmp(input, LOG_CHECKPOINT_MAGIC_VALUE, 4u) != 0)
+        return false;
+
+    size_t checksum = 0u;
+    BDP::bytesToLength(checksum, input + LOG_CHECKPOINT_CHECKSUM_OFFSET, 4u);
+
+    if(checksum != BDP::crc32c(input, LOG_CHECKPOINT_CHECKSUM_OFFSET))
+        return false;
+
+    checkpoint.sequence = readLogCheckpointField(input + 4u);
+    checkpoint.length = readLogCheckpointField(input + 12u);
+    checkpoint.pairCount = readLogCheckpointField(input + 20u);
+
+    return true;
+}
+
+BDP::PackageLog::PackageLog(const char* path, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize)
+    : PackageLog(path, nameLengthBitSize, valueLengthBitSize, 0u, DEFAULT_LOG_CHECKPOINT_INTERVAL) { }
+
+BDP::PackageLog::PackageLog(const char* path, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, uint8_t flags, uint64_t checkpointInterval)
+    : checkpointPath(std::string(path) + LOG_CHECKPOINT_EXTENSION),
+      file(nullptr),
+      checkpointFile(nullptr),
+      header(),
+      checkpointInterval(checkpointInterval),
+      length(0u),
+      pairCount(0u),
+      checkpointLength(0u),
+      checkpointSequence(0u),
+      truncatedLength(0u),
+      failed(false) {
+    if(checkpointInterval == 0u)
+        throw std::invalid_argument("checkpointInterval");
+    // The log is recovered by scanning pairs from a checkpoint, so the names must not depend on earlier pairs,
+    // and append writes the values as they are given, so they can't be compressed.
+    if((flags & (HEADER_FLAG_NAME_DICTIONARY | HEADER_FLAG_COMPRESSED)) != 0u)
+        throw std::invalid_argument("flags");
+
+    try {
+        recover(path, nameLengthBitSize, valueLengthBitSize, flags);
+
+        // Record the recovered length, so the next reopen doesn't scan the same pairs again.
+        if(length != checkpointLength)
+            checkpoint();
+    } catch(...) {
+        if(file != nullptr)
+            fclose(file);
+        if(checkpointFile != nullptr)
+            fclose(checkpointFile);
+
+        throw;
+    }
+}
+
+BDP::PackageLog::~PackageLog() {
+    try {
+        close();
+    } catch(...) { }
+}
+
+// Finds the last complete pair by scanning from the last checkpoint, and truncates everything after it.
+void BDP::PackageLog::recover(const char* path, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, uint8_t flags) {
+    uint8_t headerBytes[EXTENDED_HEADER_LENGTH];
+    size_t headerLength = encodeExtendedHeader(headerBytes, nameLengthBitSize, valueLengthBitSize, flags);
+
+    header.emplace(decodeExtendedHeader(headerBytes));
+
+    std::error_code error;
+    uint64_t fileLength = std::filesystem::file_size(path, error);
+
+    if(error)
+        fileLength = 0u;
+
+    uint8_t existingHeader[EXTENDED_HEADER_LENGTH];
+    size_t existingLength = fileLength < headerLength ? static_cast<size_t>(fileLength) : headerLength;
+
+    if(existingLength != 0u) {
+        FILE* input = fopen(path, "rb");
+
+        if(input == nullptr)
+            throw std::runtime_error("path: Cannot open file");
+
+        size_t count = fread(existingHeader, 1u, existingLength, input);
+        fclose(input);
+
+        if(count != existingLength)
+            throw std::runtime_error("path: Cannot read file");
+        if(memcmp(existingHeader, headerBytes, existingLength) != 0)
+            throw std::invalid_argument("path: The log has a different header");
+    }
+
+    // A missing or torn header means that nothing was ever committed, so the log is created again.
+    if(fileLength < headerLength) {
+        file = fopen(path, "wb+");
+        checkpointFile = fopen(checkpointPath.c_str(), "wb+");
+
+        if(file == nullptr || checkpointFile == nullptr)
+            throw std::runtime_error("path: Cannot create file");
+
+        write(headerBytes, headerLength);
+        syncLogFile(file);
+        syncLogDirectory(path);
+
+        length = headerLength;
+        truncatedLength = fileLength;
+
+        return;
+    }
+
+    checkpointFile = fopen(checkpointPath.c_str(), "rb+");
+
+    if(checkpointFile == nullptr)
+        checkpointFile = fopen(checkpointPath.c_str(), "wb+");
+    if(checkpointFile == nullptr)
+        throw std::runtime_error("path: Cannot open checkpoint file");
+
+    LogCheckpoint start = { 0u, headerLength, 0u };
+    uint8_t record[LOG_CHECKPOINT_RECORD_LENGTH];
+
+    for(uint8_t slot = 0u; slot < 2u; ++slot) {
+        LogCheckpoint candidate;
+
+        if(fread(record, 1u, LOG_CHECKPOINT_RECORD_LENGTH, checkpointFile) != LOG_CHECKPOINT_RECORD_LENGTH)
+            break;
+
+        // Checkpoints past the end of the file belong to a log which was truncated or replaced.
+        if(decodeLogCheckpoint(record, candidate) && candidate.sequence > start.sequence &&
+           candidate.length >= headerLength && candidate.length <= fileLength)
+            start = candidate;
+    }
+
+    checkpointSequence = start.sequence;
+    checkpointLength = start.length;
+
+    FILE* input = fopen(path, "rb");
+
+    if(input == nullptr)
+        throw std::runtime_error("path: Cannot open file");
+
+    std::unique_ptr<FILE, int (*)(FILE*)> inputGuard(input, fclose);
+    std::unique_ptr<uint8_t[]> buffer;
+
+    bool checksummed = (header->FLAGS & HEADER_FLAG_CHECKSUMMED) != 0u;
+    uint64_t position = start.length;
+    uint32_t crc = 0u;
+
+    if(checksummed)
+        buffer = std::make_unique<uint8_t[]>(LOG_SCAN_BUFFER_SIZE);
+
+    auto readBytes = [&](uint8_t* output, size_t count) -> bool {
+        if(fread(output, 1u, count, input) != count)
+            return false;
+
+        crc = crc32c(crc, output, count);
+        position += count;
+
+        return true;
+    };
+
+    // Without checksums, the names and values are skipped; only the length fields are read.
+    auto skipBytes = [&](size_t count) -> bool {
+        if(count > fileLength - position)
+            return false;
+
+        if(!checksummed) {
+            position += count;
+            seekLogFile(input, position);
+
+            return true;
+        }
+
+        while(count > 0u) {
+            size_t chunk = count < LOG_SCAN_BUFFER_SIZE ? count : LOG_SCAN_BUFFER_SIZE;
+
+            if(!readBytes(buffer.get(), chunk))
+                return false;
+
+            count -= chunk;
+        }
+
+        return true;
+    };
+
+    seekLogFile(input, position);
+
+    length = position;
+    pairCount = start.pairCount;
+
+    while(true) {
+        uint8_t lengthBytes[sizeof(uint64_t)];
+        size_t dataLength = 0u;
+
+        crc = 0u;
+
+        if(!readBytes(lengthBytes, header->NAME_LENGTH_BYTE_SIZE))
+            break;
+
+        bytesToLength(dataLength, lengthBytes, header->NAME_LENGTH_BYTE_SIZE);
+
+        if(!skipBytes(dataLength) || !readBytes(lengthBytes, header->VALUE_LENGTH_BYTE_SIZE))
+            break;
+
+        bytesToLength(dataLength, lengthBytes, header->VALUE_LENGTH_BYTE_SIZE);
+
+        if(!skipBytes(dataLength))
+            break;
+
+        if(checksummed) {
+            uint8_t checksumBytes[CHECKSUM_LENGTH];
+            size_t checksum = 0u;
+
+            if(fread(checksumBytes, 1u, CHECKSUM_LENGTH, input) != CHECKSUM_LENGTH)
+                break;
+
+            bytesToLength(checksum, checksumBytes, CHECKSUM_LENGTH);
+
+            if(checksum != crc)
+                break;
+
+            position += CHECKSUM_LENGTH;
+        }
+
+        length = position;
+        ++pairCount;
+    }
+
+    inputGuard.reset();
+
+    if(length < fileLength) {
+        std::filesystem::resize_file(path, length);
+        truncatedLength = fileLength - length;
+    }
+
+    file = fopen(path, "rb+");
+
+    if(file == nullptr)
+        throw std::runtime_error("path: Cannot open file");
+
+    seekLogFile(file, length);
+}
+
+void BDP::PackageLog::write(const uint8_t* data, size_t dataLength) {
+    if(dataLength != 0u && fwrite(data, 1u, dataLength, file) != dataLength)
+        throw std::runtime_error("log: Cannot write to the file");
+}
+
+void BDP::PackageLog::checkOpen() const {
+    if(file == nullptr)
+        throw std::runtime_error("log: The log is closed");
+    if(failed)
+        throw std::runtime_error("log: A write failed, so the log must be reopened to recover it");
+}
+
+size_t BDP::PackageLog::append(const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+    checkOpen();
+    if(nameLength > header->NAME_MAX_LENGTH)
+        throw std::invalid_argument("nameLength");
+    if(valueLength > header->VALUE_MAX_LENGTH)
+        throw std::invalid_argument("valueLength");
+
+    uint8_t nameLengthBytes[sizeof(uint64_t)];
+    uint8_t valueLengthBytes[sizeof(uint64_t)];
+
+    lengthToBytes(nameLengthBytes, nameLength, header->NAME_LENGTH_BYTE_SIZE);
+    lengthToBytes(valueLengthBytes, valueLength, header->VALUE_LENGTH_BYTE_SIZE);
+
+    size_t pairLength = header->NAME_LENGTH_BYTE_SIZE + nameLength + header->VALUE_LENGTH_BYTE_SIZE + valueLength;
+
+    // If a write fails, the first part of the pair may already be buffered or on disk, past the length
+    // which the next checkpoint would record. The log is marked as failed instead of being continued, and
+    // reopening it truncates the partial pair.
+    try {
+        write(nameLengthBytes, header->NAME_LENGTH_BYTE_SIZE);
+        write(name, nameLength);
+        write(valueLengthBytes, header->VALUE_LENGTH_BYTE_SIZE);
+        write(value, valueLength);
+
+        if((header->FLAGS & HEADER_FLAG_CHECKSUMMED) != 0u) {
+            uint32_t crc = crc32c(nameLengthBytes, header->NAME_LENGTH_BYTE_SIZE);
+            crc = crc32c(crc, name, nameLength);
+            crc = crc32c(crc, valueLengthBytes, header->VALUE_LENGTH_BYTE_SIZE);
+            crc = crc32c(crc, value, valueLength);
+
+            uint8_t checksum[CHECKSUM_LENGTH];
+            lengthToBytes(checksum, crc, CHECKSUM_LENGTH);
+
+            write(checksum, CHECKSUM_LENGTH);
+            pairLength += CHECKSUM_LENGTH;
+        }
+    } catch(...) {
+        failed = true;
+        throw;
+    }
+
+    length += pairLength;
+    ++pairCount;
+
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+    BDP_COUNT(BYTES_WRITTEN, pairLength);
+
+    if(length - checkpointLength >= checkpointInterval)
+        checkpoint();
+
+    return pairLength;
+}
+
+// The data is synced before the checkpoint is written, so a checkpoint never covers pairs which aren't durable.
+void BDP::PackageLog::checkpoint() {
+    checkOpen();
+
+    syncLogFile(file);
+
+    LogCheckpoint record = { checkpointSequence + 1u, length, pairCount };
+    uint8_t bytes[LOG_CHECKPOINT_RECORD_LENGTH];
+
+    encodeLogCheckpoint(bytes, record);
+
+    seekLogFile(checkpointFile, (record.sequence % 2u) * LOG_CHECKPOINT_RECORD_LENGTH);
+
+    if(fwrite(bytes, 1u, LOG_CHECKPOINT_RECORD_LENGTH, checkpointFile) != LOG_CHECKPOINT_RECORD_LENGTH)
+        throw std::runtime_error("log: Cannot write the checkpoint");
+
+    syncLogFile(checkpointFile);
+
+    checkpointSequence = record.sequence;
+    checkpointLength = length;
+}
+
+void BDP::PackageLog::close() {
+    if(file == nullptr)
+        return;
+
+    try {
+        if(length != checkpointLength && !failed)
+            checkpoint();
+    } catch(...) {
+        fclose(file);
+        fclose(checkpointFile);
+
+        file = nullptr;
+        checkpointFile = nullptr;
+
+        throw;
+    }
+
+    fclose(file);
+    fclose(checkpointFile);
+
+    file = nullptr;
+    checkpointFile = nullptr;
+}
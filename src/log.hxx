@@ -0,0 +1,82 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_LOG_HXX_INCLUDED
+#define BDP_LOG_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+
+namespace BDP {
+    /// How many bytes are appended between two automatic checkpoints. Reopening a log scans at most this many bytes.
+    const uint64_t DEFAULT_LOG_CHECKPOINT_INTERVAL = 67108864u;
+
+    class PackageLog {
+    public:
+        PackageLog(const char* path, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize);
+        PackageLog(const char* path, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, uint8_t flags, uint64_t checkpointInterval);
+        ~PackageLog();
+
+        PackageLog(const PackageLog&) = delete;
+        PackageLog& operator=(const PackageLog&) = delete;
+
+        size_t append(const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
+
+        void checkpoint();
+        void close();
+
+        const Header& getHeader() const { return *header; }
+
+        uint64_t getLength() const { return length; }
+        uint64_t getPairCount() const { return pairCount; }
+        uint64_t getCheckpointLength() const { return checkpointLength; }
+        uint64_t getTruncatedLength() const { return truncatedLength; }
+
+    private:
+        void recover(const char* path, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, uint8_t flags);
+        void write(const uint8_t* data, size_t dataLength);
+        void checkOpen() const;
+
+        std::string checkpointPath;
+        FILE* file;
+        FILE* checkpointFile;
+
+        std::optional<Header> header;
+        uint64_t checkpointInterval;
+
+        uint64_t length;
+        uint64_t pairCount;
+
+        uint64_t checkpointLength;
+        uint64_t checkpointSequence;
+        uint64_t truncatedLength;
+
+        bool failed;
+    };
+}
+
+#endif
@@ -0,0 +1,117 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "map.hxx"
+#include "hash.hxx"
+
+/// The initial capacity of a PackageMap. Must be a power of 2.
+const size_t MAP_INITIAL_CAPACITY = 16u;
+
+BDP::PackageMap::PackageMap(const PackageView& package) : PackageMap(package, DuplicatePolicy::LAST_WINS) { }
+
+BDP::PackageMap::PackageMap(const PackageView& package, DuplicatePolicy policy) : slots(),
+                                                                                  mask(0u),
+                                                                                  size(0u) {
+    // Walking the lengths is much cheaper than rehashing, so count the pairs first and size the table once.
+    // The view is iterated, so extended packages (e.g. checksummed ones) are handled like everywhere else.
+    size_t count = 0u;
+
+    for(PackageView::Iterator pair = package.begin(); pair != package.end(); ++pair)
+        ++count;
+
+    size_t capacity = MAP_INITIAL_CAPACITY;
+
+    while(capacity < count * 2u)
+        capacity <<= 1u;
+
+    slots.resize(capacity);
+    mask = capacity - 1u;
+
+    for(const PairView& pair : package)
+        insert(hashName(reinterpret_cast<const uint8_t*>(pair.name.data()), pair.name.size()), pair, policy);
+}
+
+const BDP::PairView* BDP::PackageMap::find(const uint8_t* name, size_t nameLength) const {
+    return find(std::string_view(reinterpret_cast<const char*>(name), nameLength));
+}
+
+const BDP::PairView* BDP::PackageMap::find(std::string_view name) const {
+    uint64_t hash = hashName(reinterpret_cast<const uint8_t*>(name.data()), name.size());
+
+    for(size_t slot = static_cast<size_t>(hash) & mask;; slot = (slot + 1u) & mask) {
+        const Slot& current = slots[slot];
+
+        if(current.pair.name.data() == nullptr)
+            return nullptr;
+        if(current.hash == hash && current.pair.name == name)
+            return &current.pair;
+    }
+}
+
+size_t BDP::PackageMap::getMemoryUsage() const {
+    return sizeof(*this) + slots.capacity() * sizeof(Slot);
+}
+
+// Empty slots have a null name, as names in a package always point into the package.
+void BDP::PackageMap::insert(uint64_t hash, const PairView& pair, DuplicatePolicy policy) {
+    // Keep the load factor at or below 0.5.
+    if((size + 1u) * 2u > slots.size())
+        grow();
+
+    for(size_t slot = static_cast<size_t>(hash) & mask;; slot = (slot + 1u) & mask) {
+        Slot& current = slots[slot];
+
+        if(current.pair.name.data() == nullptr) {
+            current.hash = hash;
+            current.pair = pair;
+            ++size;
+
+            return;
+        }
+
+        if(current.hash == hash && current.pair.name == pair.name) {
+            if(policy == DuplicatePolicy::LAST_WINS)
+                current.pair = pair;
+
+            return;
+        }
+    }
+}
+
+void BDP::PackageMap::grow() {
+    std::vector<Slot> previous(slots.size() * 2u);
+    previous.swap(slots);
+
+    mask = slots.size() - 1u;
+
+    for(const Slot& current : previous) {
+        if(current.pair.name.data() == nullptr)
+            continue;
+
+        size_t slot = static_cast<size_t>(current.hash) & mask;
+        while(slots[slot].pair.name.data() != nullptr)
+            slot = (slot + 1u) & mask;
+
+        slots[slot] = current;
+    }
+}
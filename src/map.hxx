@@ -0,0 +1,66 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_MAP_HXX_INCLUDED
+#define BDP_MAP_HXX_INCLUDED
+
+#include "bdp.hxx"
+#include "view.hxx"
+
+#include <string_view>
+#include <vector>
+
+namespace BDP {
+    enum class DuplicatePolicy : uint8_t {
+        FIRST_WINS,
+        LAST_WINS
+    };
+
+    class PackageMap {
+    public:
+        explicit PackageMap(const PackageView& package);
+        PackageMap(const PackageView& package, DuplicatePolicy policy);
+
+        const PairView* find(const uint8_t* name, size_t nameLength) const;
+        const PairView* find(std::string_view name) const;
+
+        size_t getSize() const { return size; }
+        size_t getCapacity() const { return slots.size(); }
+        size_t getMemoryUsage() const;
+
+    private:
+        struct Slot {
+            uint64_t hash;
+            PairView pair;
+        };
+
+        void insert(uint64_t hash, const PairView& pair, DuplicatePolicy policy);
+        void grow();
+
+        std::vector<Slot> slots;
+        size_t mask;
+        size_t size;
+    };
+}
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "metrics.hxx"
+
+#include <atomic>
+
+struct AtomicHistogram {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> totalNanoseconds;
+    std::atomic<uint64_t> buckets[BDP::LATENCY_BUCKET_COUNT];
+};
+
+// Zero-initialized, as they have static storage duration.
+std::atomic<uint64_t> METRIC_COUNTERS[BDP::COUNTER_COUNT];
+AtomicHistogram METRIC_LATENCIES[BDP::OPERATION_COUNT];
+
+const char* COUNTER_NAMES[BDP::COUNTER_COUNT] = {
+    "pairs_written",
+    "pairs_read",
+    "bytes_written",
+    "bytes_read",
+    "stream_writes",
+    "stream_reads",
+    "seeks",
+    "buffer_allocations"
+};
+
+const char* OPERATION_NAMES[BDP::OPERATION_COUNT] = {
+    "write_header",
+    "write_data",
+    "read_header",
+    "read_data",
+    "skip_data",
+    "writer_flush"
+};
+
+void BDP::addCounter(Counter counter, uint64_t amount) {
+    METRIC_COUNTERS[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void BDP::recordLatency(Operation operation, uint64_t nanoseconds) {
+    AtomicHistogram& histogram = METRIC_LATENCIES[static_cast<size_t>(operation)];
+
+    size_t bucket = 0u;
+    while(nanoseconds >> bucket != 0u && bucket < LATENCY_BUCKET_COUNT - 1u)
+        ++bucket;
+
+    histogram.count.fetch_add(1u, std::memory_order_relaxed);
+    histogram.totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    histogram.buckets[bucket].fetch_add(1u, std::memory_order_relaxed);
+}
+
+// The values are read one by one, so a snapshot taken while other threads are working
+// is not atomic as a whole; each value is exact on its own.
+BDP::MetricsSnapshot BDP::getMetricsSnapshot() {
+    MetricsSnapshot snapshot;
+
+    for(size_t i = 0u; i < COUNTER_COUNT; ++i)
+        snapshot.counters[i] = METRIC_COUNTERS[i].load(std::memory_order_relaxed);
+
+    for(size_t i = 0u; i < OPERATION_COUNT; ++i) {
+        snapshot.latencies[i].count = METRIC_LATENCIES[i].count.load(std::memory_order_relaxed);
+        snapshot.latencies[i].totalNanoseconds = METRIC_LATENCIES[i].totalNanoseconds.load(std::memory_order_relaxed);
+
+        for(size_t j = 0u; j < LATENCY_BUCKET_COUNT; ++j)
+            snapshot.latencies[i].buckets[j] = METRIC_LATENCIES[i].buckets[j].load(std::memory_order_relaxed);
+    }
+
+    return snapshot;
+}
+
+void BDP::resetMetrics() {
+    for(size_t i = 0u; i < COUNTER_COUNT; ++i)
+        METRIC_COUNTERS[i].store(0u, std::memory_order_relaxed);
+
+    for(size_t i = 0u; i < OPERATION_COUNT; ++i) {
+        METRIC_LATENCIES[i].count.store(0u, std::memory_order_relaxed);
+        METRIC_LATENCIES[i].totalNanoseconds.store(0u, std::memory_order_relaxed);
+
+        for(size_t j = 0u; j < LATENCY_BUCKET_COUNT; ++j)
+            METRIC_LATENCIES[i].buckets[j].store(0u, std::memory_order_relaxed);
+    }
+}
+
+bool BDP::isInstrumentationEnabled() {
+#ifdef BDP_INSTRUMENTATION
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char* BDP::getCounterName(Counter counter) {
+    return COUNTER_NAMES[static_cast<size_t>(counter)];
+}
+
+const char* BDP::getOperationName(Operation operation) {
+    return OPERATION_NAMES[static_cast<size_t>(operation)];
+}
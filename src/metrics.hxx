@@ -0,0 +1,109 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_METRICS_HXX_INCLUDED
+#define BDP_METRICS_HXX_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace BDP {
+    enum class Counter : uint8_t {
+        PAIRS_WRITTEN,
+        PAIRS_READ,
+        BYTES_WRITTEN,
+        BYTES_READ,
+        STREAM_WRITES,
+        STREAM_READS,
+        SEEKS,
+        BUFFER_ALLOCATIONS,
+        COUNT
+    };
+
+    enum class Operation : uint8_t {
+        WRITE_HEADER,
+        WRITE_DATA,
+        READ_HEADER,
+        READ_DATA,
+        SKIP_DATA,
+        WRITER_FLUSH,
+        COUNT
+    };
+
+    /// The number of counters.
+    const size_t COUNTER_COUNT = static_cast<size_t>(Counter::COUNT);
+    /// The number of timed operations.
+    const size_t OPERATION_COUNT = static_cast<size_t>(Operation::COUNT);
+    /// The number of latency histogram buckets. Bucket i counts latencies in [2^(i-1), 2^i) nanoseconds.
+    const size_t LATENCY_BUCKET_COUNT = 40u;
+
+    struct LatencyHistogram {
+        uint64_t count;
+        uint64_t totalNanoseconds;
+        uint64_t buckets[LATENCY_BUCKET_COUNT];
+    };
+
+    struct MetricsSnapshot {
+        uint64_t counters[COUNTER_COUNT];
+        LatencyHistogram latencies[OPERATION_COUNT];
+    };
+
+    void addCounter(Counter counter, uint64_t amount);
+    void recordLatency(Operation operation, uint64_t nanoseconds);
+
+    MetricsSnapshot getMetricsSnapshot();
+    void resetMetrics();
+
+    bool isInstrumentationEnabled();
+
+    const char* getCounterName(Counter counter);
+    const char* getOperationName(Operation operation);
+
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Operation operation) : operation(operation), start(std::chrono::steady_clock::now()) { }
+        ~ScopedTimer() {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            recordLatency(operation, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Operation operation;
+        std::chrono::steady_clock::time_point start;
+    };
+}
+
+// The hooks compile to nothing unless the library is built with BDP_INSTRUMENTATION defined.
+#ifdef BDP_INSTRUMENTATION
+    #define BDP_COUNT(counter, amount) ::BDP::addCounter(::BDP::Counter::counter, static_cast<uint64_t>(amount))
+    #define BDP_TIME(operation) ::BDP::ScopedTimer bdpScopedTimer(::BDP::Operation::operation)
+#else
+    #define BDP_COUNT(counter, amount) ((void) 0)
+    #define BDP_TIME(operation) ((void) 0)
+#endif
+
+#endif
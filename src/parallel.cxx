@@ -0,0 +1,231 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "parallel.hxx"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+/// How many chunks each thread gets, on average, when the chunk size is not specified.
+/// More chunks mean better balancing when the work per pair varies.
+const size_t CHUNKS_PER_THREAD = 16u;
+
+// Each worker owns a contiguous range of chunks. When it runs out, it takes chunks from the
+// other workers' ranges; claiming a chunk is a single fetch_add, so no locks are needed.
+struct alignas(64) ParallelWorker {
+    std::atomic<size_t> next;
+    size_t end;
+};
+
+// The jobs which one parallelForEach call hands to the pool. The pool mutex guards the active count.
+struct ParallelBatch {
+    const std::function<void(size_t)>* run;
+    size_t active;
+    std::condition_variable done;
+};
+
+struct ParallelJob {
+    ParallelBatch* batch;
+    size_t self;
+};
+
+// The threads are created on first use, and kept for the lifetime of the process, so a call doesn't
+// pay for creating threads. The pool only grows, up to the largest thread count which was requested.
+class ParallelPool {
+public:
+    ~ParallelPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+
+        available.notify_all();
+
+        for(std::thread& thread : threads)
+            thread.join();
+    }
+
+    void submit(ParallelBatch& batch, size_t jobCount) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // If a thread can't be created, the jobs wait for the existing threads, or are taken back by
+        // finish(); the calling thread takes over their chunks either way.
+        try {
+            while(threads.size() < jobCount)
+                threads.emplace_back(&ParallelPool::work, this);
+        } catch(const std::system_error&) { }
+
+        for(size_t i = 1u; i <= jobCount; ++i)
+            jobs.push_back({ &batch, i });
+
+        available.notify_all();
+    }
+
+    // Jobs which haven't started are removed, so the caller only waits for the ones which are running.
+    void finish(ParallelBatch& batch) {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        for(auto job = jobs.begin(); job != jobs.end();) {
+            if(job->batch == &batch)
+                job = jobs.erase(job);
+            else ++job;
+        }
+
+        batch.done.wait(lock, [&batch]() { return batch.active == 0u; });
+    }
+
+private:
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while(true) {
+            available.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+            if(stopping)
+                return;
+
+            ParallelJob job = jobs.front();
+            jobs.pop_front();
+
+            ++job.batch->active;
+            lock.unlock();
+
+            (*job.batch->run)(job.self);
+
+            lock.lock();
+
+            if(--job.batch->active == 0u)
+                job.batch->done.notify_all();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable available;
+    std::deque<ParallelJob> jobs;
+    std::vector<std::thread> threads;
+    bool stopping = false;
+};
+
+ParallelPool& getParallelPool() {
+    static ParallelPool pool;
+    return pool;
+}
+
+std::vector<BDP::PairView> BDP::buildOffsetTable(const PackageView& package) {
+    // The iterators are forward iterators, so assign() counts the pairs in a first walk, and the table is
+    // allocated once. The view is iterated, so extended packages (e.g. checksummed ones) are handled like
+    // everywhere else.
+    std::vector<PairView> pairs;
+    pairs.assign(package.begin(), package.end());
+
+    return pairs;
+}
+
+void BDP::parallelForEach(const PackageView& package, const ParallelFunction& function) {
+    parallelForEach(buildOffsetTable(package), function, ParallelOptions());
+}
+
+void BDP::parallelForEach(const PackageView& package, const ParallelFunction& function, const ParallelOptions& options) {
+    parallelForEach(buildOffsetTable(package), function, options);
+}
+
+void BDP::parallelForEach(const std::vector<PairView>& pairs, const ParallelFunction& function, const ParallelOptions& options) {
+    if(pairs.empty())
+        return;
+
+    size_t threadCount = options.threadCount;
+    if(threadCount == 0u)
+        threadCount = std::thread::hardware_concurrency();
+    if(threadCount == 0u)
+        threadCount = 1u;
+
+    size_t chunkSize = options.chunkSize;
+    if(chunkSize == 0u)
+        chunkSize = pairs.size() / (threadCount * CHUNKS_PER_THREAD);
+    if(chunkSize == 0u)
+        chunkSize = 1u;
+
+    size_t chunkCount = (pairs.size() + chunkSize - 1u) / chunkSize;
+    if(threadCount > chunkCount)
+        threadCount = chunkCount;
+
+    auto workers = std::make_unique<ParallelWorker[]>(threadCount);
+    for(size_t i = 0u; i < threadCount; ++i) {
+        workers[i].next.store(chunkCount * i / threadCount, std::memory_order_relaxed);
+        workers[i].end = chunkCount * (i + 1u) / threadCount;
+    }
+
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto run = [&](size_t self) {
+        try {
+            for(size_t offset = 0u; offset < threadCount && !failed.load(std::memory_order_relaxed); ++offset) {
+                ParallelWorker& victim = workers[(self + offset) % threadCount];
+                size_t chunk;
+
+                while((chunk = victim.next.fetch_add(1u, std::memory_order_relaxed)) < victim.end) {
+                    size_t begin = chunk * chunkSize;
+                    size_t end = begin + chunkSize < pairs.size() ? begin + chunkSize : pairs.size();
+
+                    for(size_t index = begin; index < end; ++index)
+                        function(index, pairs[index]);
+
+                    if(failed.load(std::memory_order_relaxed))
+                        return;
+                }
+            }
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+
+            if(!error)
+                error = std::current_exception();
+
+            failed.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    // The calling thread is one of the workers, and the others come from the pool. Every worker can
+    // take chunks from every range, so all of them are processed even if some jobs never start.
+    std::function<void(size_t)> runFunction = run;
+    ParallelBatch batch{ &runFunction, 0u, {} };
+    ParallelPool& pool = getParallelPool();
+
+    if(threadCount > 1u)
+        pool.submit(batch, threadCount - 1u);
+
+    run(0u);
+
+    if(threadCount > 1u)
+        pool.finish(batch);
+
+    if(error)
+        std::rethrow_exception(error);
+}
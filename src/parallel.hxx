@@ -0,0 +1,48 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_PARALLEL_HXX_INCLUDED
+#define BDP_PARALLEL_HXX_INCLUDED
+
+#include "bdp.hxx"
+#include "view.hxx"
+
+#include <functional>
+#include <vector>
+
+namespace BDP {
+    struct ParallelOptions {
+        size_t threadCount = 0u;
+        size_t chunkSize = 0u;
+    };
+
+    using ParallelFunction = std::function<void(size_t index, const PairView& pair)>;
+
+    std::vector<PairView> buildOffsetTable(const PackageView& package);
+
+    void parallelForEach(const PackageView& package, const ParallelFunction& function);
+    void parallelForEach(const PackageView& package, const ParallelFunction& function, const ParallelOptions& options);
+    void parallelForEach(const std::vector<PairView>& pairs, const ParallelFunction& function, const ParallelOptions& options);
+}
+
+#endif
@@ -0,0 +1,182 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "parser.hxx"
+
+#include <stdexcept>
+
+BDP::PushParser::PushParser(Handler& handler) : handler(handler),
+                                                state(State::HEADER),
+                                                header(),
+                                                partial(),
+                                                partialLength(0u),
+                                                name(),
+                                                nameLength(0u),
+                                                valueRemaining(0u) { }
+
+// Copies bytes into the partial buffer until it holds the specified length.
+// Returns true when the buffer is complete.
+bool BDP::PushParser::fillPartial(const uint8_t*& position, const uint8_t* end, size_t length) {
+    size_t available = static_cast<size_t>(end - position);
+    size_t needed = length - partialLength;
+    size_t count = available < needed ? available : needed;
+
+    memcpy(partial + partialLength, position, count);
+
+    position += count;
+    partialLength += count;
+
+    if(partialLength != length)
+        return false;
+
+    partialLength = 0u;
+    return true;
+}
+
+size_t BDP::PushParser::feed(const uint8_t* chunk, size_t chunkLength) {
+    const uint8_t* position = chunk;
+    const uint8_t* end = chunk + chunkLength;
+
+    size_t pairs = 0u;
+    size_t length;
+    PairView pair;
+
+    while(position != end) {
+        switch(state) {
+            case State::HEADER:
+                if(!fillPartial(position, end, HEADER_LENGTH))
+                    break;
+
+                header.emplace(decodeHeader(partial));
+                handler.onHeader(*header);
+
+                state = State::NAME_LENGTH;
+                break;
+            case State::NAME_LENGTH: {
+                // Fast path: the whole pair is inside the chunk, so it is emitted as views into the chunk.
+                if(partialLength == 0u && static_cast<size_t>(end - position) >= header->NAME_LENGTH_BYTE_SIZE) {
+                    const uint8_t* index = position;
+                    size_t available = static_cast<size_t>(end - index);
+
+                    bytesToLength(length, index, header->NAME_LENGTH_BYTE_SIZE);
+                    index += header->NAME_LENGTH_BYTE_SIZE;
+                    available -= header->NAME_LENGTH_BYTE_SIZE;
+
+                    if(length <= available && available - length >= header->VALUE_LENGTH_BYTE_SIZE) {
+                        pair.name = std::string_view(reinterpret_cast<const char*>(index), length);
+                        index += length;
+                        available -= length;
+
+                        bytesToLength(length, index, header->VALUE_LENGTH_BYTE_SIZE);
+                        index += header->VALUE_LENGTH_BYTE_SIZE;
+                        available -= header->VALUE_LENGTH_BYTE_SIZE;
+
+                        if(length <= available) {
+                            pair.value = std::string_view(reinterpret_cast<const char*>(index), length);
+                            position = index + length;
+
+                            handler.onPair(pair);
+                            ++pairs;
+
+                            break;
+                        }
+                    }
+                }
+
+                if(!fillPartial(position, end, header->NAME_LENGTH_BYTE_SIZE))
+                    break;
+
+                bytesToLength(nameLength, partial, header->NAME_LENGTH_BYTE_SIZE);
+
+                // The pair is split between chunks, so the name has to be kept until the value arrives.
+                // The length is untrusted, so the buffer only grows as the name bytes arrive.
+                name.clear();
+
+                state = State::NAME;
+                break;
+            }
+            case State::NAME: {
+                size_t available = static_cast<size_t>(end - position);
+                size_t needed = nameLength - name.size();
+                size_t count = available < needed ? available : needed;
+
+                name.insert(name.end(), position, position + count);
+                position += count;
+
+                if(name.size() == nameLength)
+                    state = State::VALUE_LENGTH;
+                break;
+            }
+            case State::VALUE_LENGTH:
+                if(!fillPartial(position, end, header->VALUE_LENGTH_BYTE_SIZE))
+                    break;
+
+                bytesToLength(valueRemaining, partial, header->VALUE_LENGTH_BYTE_SIZE);
+
+                pair.name = std::string_view(reinterpret_cast<const char*>(name.data()), name.size());
+
+                if(valueRemaining <= static_cast<size_t>(end - position)) {
+                    pair.value = std::string_view(reinterpret_cast<const char*>(position), valueRemaining);
+                    position += valueRemaining;
+
+                    handler.onPair(pair);
+                    ++pairs;
+
+                    state = State::NAME_LENGTH;
+                    break;
+                }
+
+                handler.onValueBegin(pair.name, valueRemaining);
+                state = State::VALUE;
+                break;
+            case State::VALUE: {
+                size_t available = static_cast<size_t>(end - position);
+                size_t count = available < valueRemaining ? available : valueRemaining;
+
+                handler.onValueData(std::string_view(reinterpret_cast<const char*>(position), count));
+
+                position += count;
+                valueRemaining -= count;
+
+                if(valueRemaining == 0u) {
+                    handler.onValueEnd();
+                    ++pairs;
+
+                    state = State::NAME_LENGTH;
+                }
+                break;
+            }
+        }
+    }
+
+    return pairs;
+}
+
+bool BDP::PushParser::isComplete() const {
+    return state == State::NAME_LENGTH && partialLength == 0u;
+}
+
+void BDP::PushParser::finish() const {
+    if(!isComplete())
+        throw std::runtime_error("input: Truncated package");
+}
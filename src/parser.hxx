@@ -0,0 +1,83 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_PARSER_HXX_INCLUDED
+#define BDP_PARSER_HXX_INCLUDED
+
+#include "bdp.hxx"
+#include "view.hxx"
+
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace BDP {
+    class PushParser {
+    public:
+        class Handler {
+        public:
+            virtual ~Handler() = default;
+
+            virtual void onHeader(const Header& /* header */) { }
+
+            virtual void onPair(const PairView& /* pair */) { }
+
+            virtual void onValueBegin(std::string_view /* name */, size_t /* valueLength */) { }
+            virtual void onValueData(std::string_view /* data */) { }
+            virtual void onValueEnd() { }
+        };
+
+        explicit PushParser(Handler& handler);
+
+        size_t feed(const uint8_t* chunk, size_t chunkLength);
+        void finish() const;
+
+        bool isComplete() const;
+        const Header* getHeader() const { return header ? &*header : nullptr; }
+
+    private:
+        enum class State : uint8_t {
+            HEADER,
+            NAME_LENGTH,
+            NAME,
+            VALUE_LENGTH,
+            VALUE
+        };
+
+        bool fillPartial(const uint8_t*& position, const uint8_t* end, size_t length);
+
+        Handler& handler;
+        State state;
+
+        std::optional<Header> header;
+
+        uint8_t partial[HEADER_LENGTH > sizeof(uint64_t) ? HEADER_LENGTH : sizeof(uint64_t)];
+        size_t partialLength;
+
+        std::vector<uint8_t> name;
+        size_t nameLength;
+        size_t valueRemaining;
+    };
+}
+
+#endif
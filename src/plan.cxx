@@ -0,0 +1,136 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "plan.hxx"
+#include "codec.hxx"
+
+#include <stdexcept>
+
+uint8_t getNarrowestBitSize(size_t length) {
+    if(length <= BDP::getMaxLength(8u))
+        return 8u;
+    if(length <= BDP::getMaxLength(16u))
+        return 16u;
+    if(length <= BDP::getMaxLength(32u))
+        return 32u;
+
+    return 64u;
+}
+
+void finishPlan(BDP::PackagePlan& plan) {
+    plan.nameLengthBitSize = getNarrowestBitSize(plan.maxNameLength);
+    plan.valueLengthBitSize = getNarrowestBitSize(plan.maxValueLength);
+    plan.length = plan.getLength(plan.nameLengthBitSize, plan.valueLengthBitSize);
+}
+
+// Returns 0 if the pairs don't fit in the package type. Valid packages are at least HEADER_LENGTH bytes long.
+size_t BDP::PackagePlan::getLength(uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) const {
+    if(maxNameLength > getMaxLength(nameLengthBitSize) || maxValueLength > getMaxLength(valueLengthBitSize))
+        return 0u;
+
+    return HEADER_LENGTH + pairCount * (nameLengthBitSize / 8u + valueLengthBitSize / 8u) + totalNameLength + totalValueLength;
+}
+
+size_t BDP::getPairLength(const Header* header, size_t nameLength, size_t valueLength) {
+    return header->NAME_LENGTH_BYTE_SIZE + nameLength + header->VALUE_LENGTH_BYTE_SIZE + valueLength;
+}
+
+BDP::PackagePlan BDP::planPackage(const size_t* nameLengths, const size_t* valueLengths, size_t count) {
+    PackagePlan plan = { count, 0u, 0u, 0u, 0u, 0u, 0u, 0u };
+
+    for(size_t i = 0u; i < count; ++i) {
+        plan.totalNameLength += nameLengths[i];
+        plan.totalValueLength += valueLengths[i];
+
+        if(nameLengths[i] > plan.maxNameLength)
+            plan.maxNameLength = nameLengths[i];
+        if(valueLengths[i] > plan.maxValueLength)
+            plan.maxValueLength = valueLengths[i];
+    }
+
+    finishPlan(plan);
+    return plan;
+}
+
+BDP::PackagePlan BDP::planPackage(const PairView* pairs, size_t count) {
+    PackagePlan plan = { count, 0u, 0u, 0u, 0u, 0u, 0u, 0u };
+
+    for(size_t i = 0u; i < count; ++i) {
+        plan.totalNameLength += pairs[i].name.size();
+        plan.totalValueLength += pairs[i].value.size();
+
+        if(pairs[i].name.size() > plan.maxNameLength)
+            plan.maxNameLength = pairs[i].name.size();
+        if(pairs[i].value.size() > plan.maxValueLength)
+            plan.maxValueLength = pairs[i].value.size();
+    }
+
+    finishPlan(plan);
+    return plan;
+}
+
+size_t BDP::encodePackage(const PackagePlan& plan, const PairView* pairs, size_t count, uint8_t* output, size_t outputLength) {
+    if(count != plan.pairCount)
+        throw std::invalid_argument("count");
+    if(outputLength < plan.length)
+        throw std::invalid_argument("outputLength");
+
+    return dispatch(getHeaderByte(plan.nameLengthBitSize, plan.valueLengthBitSize), [&](auto codec) {
+        using PlanCodec = decltype(codec);
+
+        size_t index = PlanCodec::writeHeader(output);
+
+        // The plan may not match the pairs, so every pair is checked against the package type and the
+        // remaining space before it is written.
+        for(size_t i = 0u; i < count; ++i) {
+            size_t nameLength = pairs[i].name.size();
+            size_t valueLength = pairs[i].value.size();
+
+            if(nameLength > PlanCodec::NAME_MAX_LENGTH || valueLength > PlanCodec::VALUE_MAX_LENGTH)
+                throw std::invalid_argument("pairs: The pairs don't fit in the planned package type");
+            if(outputLength - index < PlanCodec::NAME_LENGTH_BYTE_SIZE + PlanCodec::VALUE_LENGTH_BYTE_SIZE ||
+               outputLength - index - PlanCodec::NAME_LENGTH_BYTE_SIZE - PlanCodec::VALUE_LENGTH_BYTE_SIZE < nameLength ||
+               outputLength - index - PlanCodec::NAME_LENGTH_BYTE_SIZE - PlanCodec::VALUE_LENGTH_BYTE_SIZE - nameLength < valueLength)
+                throw std::invalid_argument("outputLength: The pairs don't fit in the byte array");
+
+            index += PlanCodec::writePair(output + index,
+                                          reinterpret_cast<const uint8_t*>(pairs[i].name.data()), nameLength,
+                                          reinterpret_cast<const uint8_t*>(pairs[i].value.data()), valueLength);
+        }
+
+        return index;
+    });
+}
+
+std::unique_ptr<uint8_t[]> BDP::encodePackage(const PairView* pairs, size_t count, size_t* packageLength) {
+    PackagePlan plan = planPackage(pairs, count);
+
+    // The plan is exact, so this is the only allocation.
+    auto output = std::make_unique<uint8_t[]>(plan.length);
+    encodePackage(plan, pairs, count, output.get(), plan.length);
+
+    if(packageLength != nullptr)
+        *packageLength = plan.length;
+
+    return output;
+}
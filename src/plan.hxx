@@ -0,0 +1,59 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_PLAN_HXX_INCLUDED
+#define BDP_PLAN_HXX_INCLUDED
+
+#include "bdp.hxx"
+#include "view.hxx"
+
+#include <memory>
+
+namespace BDP {
+    struct PackagePlan {
+        size_t getLength(uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) const;
+
+        size_t pairCount;
+
+        size_t totalNameLength;
+        size_t totalValueLength;
+
+        size_t maxNameLength;
+        size_t maxValueLength;
+
+        uint8_t nameLengthBitSize;
+        uint8_t valueLengthBitSize;
+
+        size_t length;
+    };
+
+    size_t getPairLength(const Header* header, size_t nameLength, size_t valueLength);
+
+    PackagePlan planPackage(const size_t* nameLengths, const size_t* valueLengths, size_t count);
+    PackagePlan planPackage(const PairView* pairs, size_t count);
+
+    size_t encodePackage(const PackagePlan& plan, const PairView* pairs, size_t count, uint8_t* output, size_t outputLength);
+    std::unique_ptr<uint8_t[]> encodePackage(const PairView* pairs, size_t count, size_t* packageLength);
+}
+
+#endif
@@ -0,0 +1,211 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "scan.hxx"
+#include "checksum.hxx"
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+/// The default size of the buffer used to stream values.
+const size_t SCAN_BUFFER_SIZE = 16384u;
+/// The names and values are read in chunks of this size, so a corrupted length can't allocate more than what was read.
+const size_t SCAN_CHUNK_SIZE = 65536u;
+
+void readScanLength(std::istream& input, uint8_t lengthByteSize, size_t& length) {
+    uint8_t lengthBytes[sizeof(size_t)];
+    input.read(reinterpret_cast<char*>(lengthBytes), lengthByteSize);
+
+    if(static_cast<size_t>(input.gcount()) != lengthByteSize)
+        throw std::runtime_error("input: Truncated pair");
+
+    length = 0u;
+    BDP::bytesToLength(length, lengthBytes, lengthByteSize);
+}
+
+// Returns the length of the trailer which follows every value. The checksums of checksummed packages are skipped,
+// like in PackageView; the other flags change what the fields mean, so those packages can't be scanned.
+size_t getScanTrailerLength(const BDP::Header* header) {
+    if((header->FLAGS & BDP::HEADER_FLAG_NAME_DICTIONARY) != 0u)
+        throw std::invalid_argument("header: Dictionary packages must be read with a NameDictionary");
+    if((header->FLAGS & BDP::HEADER_FLAG_COMPRESSED) != 0u)
+        throw std::invalid_argument("header: Compressed packages can't be scanned");
+
+    return (header->FLAGS & BDP::HEADER_FLAG_CHECKSUMMED) != 0u ? BDP::CHECKSUM_LENGTH : 0u;
+}
+
+void skipScanTrailer(std::istream& input, size_t trailerLength) {
+    if(trailerLength == 0u)
+        return;
+
+    input.ignore(static_cast<std::streamsize>(trailerLength));
+
+    if(static_cast<size_t>(input.gcount()) != trailerLength)
+        throw std::runtime_error("input: Truncated pair");
+}
+
+void readScanBytes(std::istream& input, std::vector<uint8_t>& bytes, size_t length) {
+    bytes.clear();
+
+    while(bytes.size() < length) {
+        size_t offset = bytes.size();
+        size_t chunkLength = length - offset < SCAN_CHUNK_SIZE ? length - offset : SCAN_CHUNK_SIZE;
+
+        bytes.resize(offset + chunkLength);
+        input.read(reinterpret_cast<char*>(bytes.data() + offset), chunkLength);
+
+        if(static_cast<size_t>(input.gcount()) != chunkLength)
+            throw std::runtime_error("input: Truncated pair");
+    }
+}
+
+size_t BDP::scan(const BDP::Header* header, std::istream& input, const ScanFilter& filter, const ScanHandler& handler) {
+    return scan(header, input, filter, handler, nullptr, SCAN_BUFFER_SIZE);
+}
+
+size_t BDP::scan(const BDP::Header* header, std::istream& input, const ScanFilter& filter, const ScanHandler& handler, const ScanStreamSelector& selector) {
+    return scan(header, input, filter, handler, selector, SCAN_BUFFER_SIZE);
+}
+
+size_t BDP::scan(const BDP::Header* header, std::istream& input, const ScanFilter& filter, const ScanHandler& handler, const ScanStreamSelector& selector, size_t bufferSize) {
+    // The name, value and copy buffers are reused for every pair.
+    std::vector<uint8_t> name;
+    std::vector<uint8_t> value;
+    auto buffer = std::make_unique<char[]>(bufferSize);
+
+    size_t trailerLength = getScanTrailerLength(header);
+    size_t count = 0u;
+    size_t nameLength;
+    size_t valueLength;
+
+    while(input.peek() != std::char_traits<char>::eof()) {
+        readScanLength(input, header->NAME_LENGTH_BYTE_SIZE, nameLength);
+        readScanBytes(input, name, nameLength);
+
+        Projection projection = filter(name.data(), nameLength);
+        std::ostream* output = nullptr;
+
+        if(projection == Projection::STREAM && selector)
+            output = selector(name.data(), nameLength);
+
+        if(projection != Projection::MATERIALIZE && output == nullptr) {
+            skipData(header->VALUE_LENGTH_BYTE_SIZE, input);
+            skipScanTrailer(input, trailerLength);
+            continue;
+        }
+
+        readScanLength(input, header->VALUE_LENGTH_BYTE_SIZE, valueLength);
+
+        if(projection == Projection::MATERIALIZE) {
+            readScanBytes(input, value, valueLength);
+
+            if(handler)
+                handler(name.data(), nameLength, value.data(), valueLength);
+
+            ++count;
+        } else if(output != nullptr) {
+            size_t remaining = valueLength;
+            size_t nextLength;
+
+            while(remaining > 0u) {
+                nextLength = remaining < bufferSize ? remaining : bufferSize;
+                input.read(buffer.get(), nextLength);
+
+                if(input.gcount() == 0)
+                    throw std::runtime_error("input: Truncated pair");
+
+                output->write(buffer.get(), input.gcount());
+                remaining -= static_cast<size_t>(input.gcount());
+            }
+
+            ++count;
+        }
+
+        skipScanTrailer(input, trailerLength);
+    }
+
+    return count;
+}
+
+size_t BDP::scan(const BDP::Header* header, const uint8_t* input, size_t inputLength, const ScanFilter& filter, const ScanHandler& handler) {
+    return scan(header, input, inputLength, filter, handler, nullptr);
+}
+
+size_t BDP::scan(const BDP::Header* header, const uint8_t* input, size_t inputLength, const ScanFilter& filter, const ScanHandler& handler, const ScanStreamSelector& selector) {
+    const uint8_t* end = input + inputLength;
+
+    size_t trailerLength = getScanTrailerLength(header);
+    size_t count = 0u;
+    size_t nameLength;
+    size_t valueLength;
+
+    while(input != end) {
+        if(static_cast<size_t>(end - input) < header->NAME_LENGTH_BYTE_SIZE)
+            throw std::runtime_error("input: Truncated pair");
+
+        bytesToLength(nameLength, input, header->NAME_LENGTH_BYTE_SIZE);
+        input += header->NAME_LENGTH_BYTE_SIZE;
+
+        if(static_cast<size_t>(end - input) < nameLength)
+            throw std::runtime_error("input: Truncated pair");
+
+        const uint8_t* name = input;
+        input += nameLength;
+
+        if(static_cast<size_t>(end - input) < header->VALUE_LENGTH_BYTE_SIZE)
+            throw std::runtime_error("input: Truncated pair");
+
+        bytesToLength(valueLength, input, header->VALUE_LENGTH_BYTE_SIZE);
+        input += header->VALUE_LENGTH_BYTE_SIZE;
+
+        if(static_cast<size_t>(end - input) < valueLength || static_cast<size_t>(end - input) - valueLength < trailerLength)
+            throw std::runtime_error("input: Truncated pair");
+
+        // The value is already in memory, so skipping it is only pointer arithmetic.
+        switch(filter(name, nameLength)) {
+            case Projection::MATERIALIZE:
+                if(handler)
+                    handler(name, nameLength, input, valueLength);
+
+                ++count;
+                break;
+            case Projection::STREAM:
+                if(selector) {
+                    std::ostream* output = selector(name, nameLength);
+
+                    if(output != nullptr) {
+                        output->write(reinterpret_cast<const char*>(input), valueLength);
+                        ++count;
+                    }
+                }
+                break;
+            case Projection::SKIP:
+                break;
+        }
+
+        input += valueLength + trailerLength;
+    }
+
+    return count;
+}
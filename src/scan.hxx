@@ -0,0 +1,51 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_SCAN_HXX_INCLUDED
+#define BDP_SCAN_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <functional>
+#include <istream>
+#include <ostream>
+
+namespace BDP {
+    enum class Projection : uint8_t {
+        SKIP,
+        MATERIALIZE,
+        STREAM
+    };
+
+    using ScanFilter = std::function<Projection(const uint8_t* name, size_t nameLength)>;
+    using ScanHandler = std::function<void(const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength)>;
+    using ScanStreamSelector = std::function<std::ostream*(const uint8_t* name, size_t nameLength)>;
+
+    size_t scan(const Header* header, std::istream& input, const ScanFilter& filter, const ScanHandler& handler);
+    size_t scan(const Header* header, std::istream& input, const ScanFilter& filter, const ScanHandler& handler, const ScanStreamSelector& selector);
+    size_t scan(const Header* header, std::istream& input, const ScanFilter& filter, const ScanHandler& handler, const ScanStreamSelector& selector, size_t bufferSize);
+    size_t scan(const Header* header, const uint8_t* input, size_t inputLength, const ScanFilter& filter, const ScanHandler& handler);
+    size_t scan(const Header* header, const uint8_t* input, size_t inputLength, const ScanFilter& filter, const ScanHandler& handler, const ScanStreamSelector& selector);
+}
+
+#endif
@@ -0,0 +1,280 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "stream.hxx"
+#include "checksum.hxx"
+#include "metrics.hxx"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+BDP::PackageStream::PackageStream(std::istream& input) : PackageStream(input, DEFAULT_STREAM_WINDOW_SIZE) { }
+
+BDP::PackageStream::PackageStream(std::istream& input, size_t windowSize)
+    : input(input),
+      window(),
+      windowSize(windowSize),
+      windowStart(0u),
+      windowEnd(0u),
+      header(),
+      trailerLength(0u),
+      trailerPending(false),
+      pair(),
+      name(),
+      valueRemaining(0u),
+      started(false),
+      finished(false) {
+    // The window must be able to hold the header, and the length fields of a pair.
+    if(windowSize < 2u * sizeof(uint64_t))
+        throw std::invalid_argument("windowSize");
+
+    window = std::make_unique<uint8_t[]>(windowSize);
+    BDP_COUNT(BUFFER_ALLOCATIONS, 1u);
+
+    if(!fill(HEADER_LENGTH))
+        throw std::runtime_error("input: Truncated header");
+
+    size_t headerLength = HEADER_LENGTH;
+
+    if(memcmp(window.get(), "BDX", 3u) == 0) {
+        if(!fill(EXTENDED_HEADER_LENGTH))
+            throw std::runtime_error("input: Truncated header");
+
+        headerLength = EXTENDED_HEADER_LENGTH;
+    }
+
+    header.emplace(decodeExtendedHeader(window.get()));
+    windowStart += headerLength;
+
+    if((header->FLAGS & HEADER_FLAG_NAME_DICTIONARY) != 0u)
+        throw std::invalid_argument("input: Dictionary packages must be read with a NameDictionary");
+
+    // The checksums of checksummed packages are skipped, like in PackageView.
+    if((header->FLAGS & HEADER_FLAG_CHECKSUMMED) != 0u)
+        trailerLength = CHECKSUM_LENGTH;
+}
+
+// Makes sure that the window contains at least length bytes, which must not exceed the window size.
+// The window may be compacted, so the views of the previous pair are invalidated.
+bool BDP::PackageStream::fill(size_t length) {
+    if(windowEnd - windowStart >= length)
+        return true;
+
+    if(windowStart + length > windowSize) {
+        memmove(window.get(), window.get() + windowStart, windowEnd - windowStart);
+
+        windowEnd -= windowStart;
+        windowStart = 0u;
+    }
+
+    while(windowEnd - windowStart < length) {
+        input.read(reinterpret_cast<char*>(window.get() + windowEnd), static_cast<std::streamsize>(windowSize - windowEnd));
+
+        size_t count = static_cast<size_t>(input.gcount());
+        windowEnd += count;
+
+        BDP_COUNT(STREAM_READS, 1u);
+
+        if(count == 0u)
+            return false;
+    }
+
+    return true;
+}
+
+// Skips the part of the previous value which wasn't read, and its trailer.
+void BDP::PackageStream::skipRemaining() {
+    size_t length = valueRemaining + (trailerPending ? trailerLength : 0u);
+
+    valueRemaining = 0u;
+    trailerPending = false;
+
+    size_t buffered = length < windowEnd - windowStart ? length : windowEnd - windowStart;
+
+    windowStart += buffered;
+    length -= buffered;
+
+    while(length > 0u) {
+        size_t limit = static_cast<size_t>(std::numeric_limits<std::streamsize>::max());
+        size_t chunk = length < limit ? length : limit;
+
+        input.ignore(static_cast<std::streamsize>(chunk));
+
+        if(static_cast<size_t>(input.gcount()) != chunk)
+            throw std::runtime_error("input: Truncated value");
+
+        length -= chunk;
+    }
+}
+
+// Copies a name which doesn't fit in the window. The copy grows as the bytes arrive, so a corrupt
+// length can't allocate more than the stream holds.
+void BDP::PackageStream::readName(size_t nameLength) {
+    name.clear();
+
+    while(name.size() < nameLength) {
+        if(windowStart == windowEnd) {
+            windowStart = 0u;
+            windowEnd = 0u;
+
+            if(!fill(1u))
+                throw std::runtime_error("input: Truncated name");
+        }
+
+        size_t remaining = nameLength - name.size();
+        size_t length = remaining < windowEnd - windowStart ? remaining : windowEnd - windowStart;
+
+        name.append(reinterpret_cast<const char*>(window.get() + windowStart), length);
+        windowStart += length;
+    }
+}
+
+bool BDP::PackageStream::next() {
+    if(finished)
+        return false;
+
+    started = true;
+    skipRemaining();
+
+    uint8_t nameLengthByteSize = header->NAME_LENGTH_BYTE_SIZE;
+    uint8_t valueLengthByteSize = header->VALUE_LENGTH_BYTE_SIZE;
+
+    if(!fill(nameLengthByteSize)) {
+        if(windowEnd != windowStart)
+            throw std::runtime_error("input: Truncated name length");
+
+        finished = true;
+        return false;
+    }
+
+    size_t nameLength = 0u;
+    size_t valueLength = 0u;
+
+    bytesToLength(nameLength, window.get() + windowStart, nameLengthByteSize);
+
+    // The length comes from the input, so it is compared with the window before any arithmetic.
+    // The window holds at least the two length fields, so the subtraction can't wrap.
+    if(nameLength > windowSize - nameLengthByteSize - valueLengthByteSize) {
+        windowStart += nameLengthByteSize;
+        readName(nameLength);
+
+        if(!fill(valueLengthByteSize))
+            throw std::runtime_error("input: Truncated value length");
+
+        bytesToLength(valueLength, window.get() + windowStart, valueLengthByteSize);
+
+        pair.name = name;
+        pair.value = std::string_view();
+        pair.valueLength = valueLength;
+
+        windowStart += valueLengthByteSize;
+        valueRemaining = valueLength;
+        trailerPending = true;
+
+        BDP_COUNT(PAIRS_READ, 1u);
+        BDP_COUNT(BYTES_READ, nameLengthByteSize + nameLength + valueLengthByteSize + valueLength + trailerLength);
+
+        return true;
+    }
+
+    size_t fieldsLength = nameLengthByteSize + nameLength + valueLengthByteSize;
+
+    if(!fill(fieldsLength))
+        throw std::runtime_error("input: Truncated name");
+
+    bytesToLength(valueLength, window.get() + windowStart + nameLengthByteSize + nameLength, valueLengthByteSize);
+
+    // Pairs which fit in the window are exposed as views; larger values are streamed in chunks.
+    if(fieldsLength + trailerLength <= windowSize && valueLength <= windowSize - fieldsLength - trailerLength) {
+        if(!fill(fieldsLength + valueLength))
+            throw std::runtime_error("input: Truncated value");
+
+        const char* pairStart = reinterpret_cast<const char*>(window.get() + windowStart);
+
+        pair.name = std::string_view(pairStart + nameLengthByteSize, nameLength);
+        pair.value = std::string_view(pairStart + fieldsLength, valueLength);
+
+        windowStart += fieldsLength + valueLength;
+    } else {
+        name.assign(reinterpret_cast<const char*>(window.get() + windowStart + nameLengthByteSize), nameLength);
+
+        pair.name = name;
+        pair.value = std::string_view();
+
+        windowStart += fieldsLength;
+        valueRemaining = valueLength;
+    }
+
+    pair.valueLength = valueLength;
+    trailerPending = true;
+
+    BDP_COUNT(PAIRS_READ, 1u);
+    BDP_COUNT(BYTES_READ, fieldsLength + valueLength + trailerLength);
+
+    return true;
+}
+
+BDP::PackageStream::Iterator BDP::PackageStream::begin() {
+    if(!started)
+        next();
+
+    return finished ? end() : Iterator(this);
+}
+
+std::string_view BDP::PackageStream::readValueChunk() {
+    if(valueRemaining == 0u)
+        return std::string_view();
+
+    if(windowStart == windowEnd) {
+        windowStart = 0u;
+        windowEnd = 0u;
+
+        if(!fill(1u))
+            throw std::runtime_error("input: Truncated value");
+    }
+
+    size_t length = valueRemaining < windowEnd - windowStart ? valueRemaining : windowEnd - windowStart;
+    std::string_view chunk(reinterpret_cast<const char*>(window.get() + windowStart), length);
+
+    windowStart += length;
+    valueRemaining -= length;
+
+    return chunk;
+}
+
+size_t BDP::PackageStream::copyValue(std::ostream& output) {
+    if(pair.isValueBuffered()) {
+        output.write(pair.value.data(), static_cast<std::streamsize>(pair.value.size()));
+        return pair.value.size();
+    }
+
+    size_t count = 0u;
+
+    for(std::string_view chunk = readValueChunk(); !chunk.empty(); chunk = readValueChunk()) {
+        output.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        count += chunk.size();
+    }
+
+    return count;
+}
@@ -0,0 +1,124 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_STREAM_HXX_INCLUDED
+#define BDP_STREAM_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <cstddef>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace BDP {
+    /// The default size of the read-ahead window. Pairs which fit in it are exposed as views.
+    const size_t DEFAULT_STREAM_WINDOW_SIZE = 65536u;
+
+    struct StreamPair {
+        std::string_view name;
+        std::string_view value;
+        size_t valueLength;
+
+        // Values which don't fit in the window are read with PackageStream::readValueChunk.
+        bool isValueBuffered() const { return value.size() == valueLength; }
+    };
+
+    class PackageStream {
+    public:
+        class Iterator {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type        = StreamPair;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const StreamPair*;
+            using reference         = const StreamPair&;
+
+            Iterator() : stream(nullptr) { }
+            explicit Iterator(PackageStream* stream) : stream(stream) { }
+
+            reference operator*() const { return stream->pair; }
+            pointer operator->() const { return &stream->pair; }
+
+            Iterator& operator++();
+
+            bool operator==(const Iterator& other) const { return stream == other.stream; }
+            bool operator!=(const Iterator& other) const { return stream != other.stream; }
+
+        private:
+            PackageStream* stream;
+        };
+
+        explicit PackageStream(std::istream& input);
+        PackageStream(std::istream& input, size_t windowSize);
+
+        PackageStream(const PackageStream&) = delete;
+        PackageStream& operator=(const PackageStream&) = delete;
+
+        const Header& getHeader() const { return *header; }
+
+        Iterator begin();
+        Iterator end() { return Iterator(); }
+
+        bool next();
+
+        std::string_view readValueChunk();
+        size_t copyValue(std::ostream& output);
+
+    private:
+        bool fill(size_t length);
+        void readName(size_t nameLength);
+        void skipRemaining();
+
+        std::istream& input;
+
+        std::unique_ptr<uint8_t[]> window;
+        size_t windowSize;
+        size_t windowStart;
+        size_t windowEnd;
+
+        std::optional<Header> header;
+        size_t trailerLength;
+        bool trailerPending;
+
+        StreamPair pair;
+        std::string name;
+        size_t valueRemaining;
+
+        bool started;
+        bool finished;
+    };
+
+    inline PackageStream::Iterator& PackageStream::Iterator::operator++() {
+        if(!stream->next())
+            stream = nullptr;
+
+        return *this;
+    }
+}
+
+#endif
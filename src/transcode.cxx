@@ -0,0 +1,201 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "transcode.hxx"
+#include "codec.hxx"
+#include "metrics.hxx"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+[[noreturn]] void throwTranscodeLengthError(const char* field, uint64_t offset) {
+    throw std::runtime_error(std::string("input: The ") + field + " of the pair at offset " + std::to_string(offset) +
+                             " is too long for the output package type");
+}
+
+const uint8_t* checkTranscodeInput(const uint8_t* input, size_t inputLength) {
+    if(inputLength < BDP::HEADER_LENGTH || memcmp(input, "BDP", BDP::HEADER_LENGTH - 1u) != 0)
+        throw std::invalid_argument("input: Invalid package header");
+
+    return input + BDP::HEADER_LENGTH;
+}
+
+// Both package types are known at compile time, so the length fields are fixed-width loads and stores,
+// the checks which can never fail are removed, and the names and values are copied as whole blocks.
+template<typename Input, typename Output>
+size_t transcodePairs(const uint8_t* package, const uint8_t* input, const uint8_t* end, uint8_t* output, const uint8_t* outputEnd) {
+    uint8_t* index = output;
+
+    while(input != end) {
+        const uint8_t* pair = input;
+
+        if(static_cast<size_t>(end - input) < Input::NAME_LENGTH_BYTE_SIZE)
+            throw std::runtime_error("input: Truncated name length");
+
+        size_t nameLength = Input::NameLength::decode(input);
+        const uint8_t* name = input + Input::NAME_LENGTH_BYTE_SIZE;
+
+        if(static_cast<size_t>(end - name) < nameLength)
+            throw std::runtime_error("input: Truncated name");
+
+        if constexpr(Input::NAME_MAX_LENGTH > Output::NAME_MAX_LENGTH) {
+            if(nameLength > Output::NAME_MAX_LENGTH)
+                throwTranscodeLengthError("name", static_cast<uint64_t>(pair - package));
+        }
+
+        input = name + nameLength;
+
+        if(static_cast<size_t>(end - input) < Input::VALUE_LENGTH_BYTE_SIZE)
+            throw std::runtime_error("input: Truncated value length");
+
+        size_t valueLength = Input::ValueLength::decode(input);
+        const uint8_t* value = input + Input::VALUE_LENGTH_BYTE_SIZE;
+
+        if(static_cast<size_t>(end - value) < valueLength)
+            throw std::runtime_error("input: Truncated value");
+
+        if constexpr(Input::VALUE_MAX_LENGTH > Output::VALUE_MAX_LENGTH) {
+            if(valueLength > Output::VALUE_MAX_LENGTH)
+                throwTranscodeLengthError("value", static_cast<uint64_t>(pair - package));
+        }
+
+        input = value + valueLength;
+
+        if(Output::getPairLength(nameLength, valueLength) > static_cast<size_t>(outputEnd - index))
+            throw std::invalid_argument("outputLength");
+
+        index += Output::writePair(index, name, nameLength, value, valueLength);
+    }
+
+    return static_cast<size_t>(index - output);
+}
+
+size_t readTranscodeLength(std::istream& input, uint8_t lengthByteSize, const char* error) {
+    uint8_t lengthBytes[sizeof(uint64_t)];
+    size_t length = 0u;
+
+    input.read((char*) lengthBytes, lengthByteSize);
+
+    if(static_cast<size_t>(input.gcount()) != lengthByteSize)
+        throw std::runtime_error(error);
+
+    BDP::bytesToLength(length, lengthBytes, lengthByteSize);
+
+    return length;
+}
+
+size_t BDP::getTranscodedLength(const uint8_t* input, size_t inputLength, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
+    const uint8_t* pairs = checkTranscodeInput(input, inputLength);
+
+    uint8_t headerBytes[HEADER_LENGTH];
+    encodeHeader(headerBytes, nameLengthBitSize, valueLengthBitSize);
+
+    return dispatch(input[HEADER_LENGTH - 1u], [&](auto codec) {
+        using Input = decltype(codec);
+
+        size_t pairCount = Input::forEach(pairs, inputLength - HEADER_LENGTH, [](const PairView&) { });
+        size_t outputFieldsLength = (nameLengthBitSize + valueLengthBitSize) / 8u;
+        size_t inputFieldsLength = Input::NAME_LENGTH_BYTE_SIZE + Input::VALUE_LENGTH_BYTE_SIZE;
+
+        return inputLength - pairCount * inputFieldsLength + pairCount * outputFieldsLength;
+    });
+}
+
+size_t BDP::transcodePackage(const uint8_t* input, size_t inputLength, uint8_t* output, size_t outputLength, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
+    const uint8_t* pairs = checkTranscodeInput(input, inputLength);
+
+    uint8_t headerBytes[HEADER_LENGTH];
+    encodeHeader(headerBytes, nameLengthBitSize, valueLengthBitSize);
+
+    if(outputLength < HEADER_LENGTH)
+        throw std::invalid_argument("outputLength");
+
+    // The same package type needs no repacking.
+    if(headerBytes[HEADER_LENGTH - 1u] == input[HEADER_LENGTH - 1u]) {
+        if(outputLength < inputLength)
+            throw std::invalid_argument("outputLength");
+
+        memcpy(output, input, inputLength);
+        BDP_COUNT(BYTES_WRITTEN, inputLength);
+
+        return inputLength;
+    }
+
+    memcpy(output, headerBytes, HEADER_LENGTH);
+
+    size_t count = dispatch(input[HEADER_LENGTH - 1u], [&](auto inputCodec) {
+        return dispatch(headerBytes[HEADER_LENGTH - 1u], [&](auto outputCodec) {
+            return transcodePairs<decltype(inputCodec), decltype(outputCodec)>(input, pairs, input + inputLength, output + HEADER_LENGTH,
+                                                                               output + outputLength);
+        });
+    });
+
+    BDP_COUNT(BYTES_WRITTEN, HEADER_LENGTH + count);
+
+    return HEADER_LENGTH + count;
+}
+
+size_t BDP::transcodePackage(std::istream& input, std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
+    return transcodePackage(input, output, nameLengthBitSize, valueLengthBitSize, DEFAULT_TRANSCODE_BUFFER_SIZE);
+}
+
+size_t BDP::transcodePackage(std::istream& input, std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, size_t bufferSize) {
+    if(bufferSize == 0u)
+        throw std::invalid_argument("bufferSize");
+
+    std::unique_ptr<Header> inputHeader(readHeader(input));
+
+    uint8_t headerBytes[HEADER_LENGTH];
+    encodeHeader(headerBytes, nameLengthBitSize, valueLengthBitSize);
+
+    Header outputHeader = decodeHeader(headerBytes);
+    output.write((char*) headerBytes, HEADER_LENGTH);
+
+    auto buffer = std::make_unique<uint8_t[]>(bufferSize);
+    BDP_COUNT(BUFFER_ALLOCATIONS, 1u);
+
+    uint64_t offset = HEADER_LENGTH;
+    size_t count = HEADER_LENGTH;
+
+    // Only the length fields are decoded; the names and values are copied through the buffer.
+    while(input.peek() != std::char_traits<char>::eof()) {
+        size_t nameLength = readTranscodeLength(input, inputHeader->NAME_LENGTH_BYTE_SIZE, "input: Truncated name length");
+
+        if(nameLength > outputHeader.NAME_MAX_LENGTH)
+            throwTranscodeLengthError("name", offset);
+
+        count += writeSizedData(outputHeader.NAME_MAX_LENGTH, outputHeader.NAME_LENGTH_BYTE_SIZE, output, input, nameLength, buffer.get(), bufferSize);
+
+        size_t valueLength = readTranscodeLength(input, inputHeader->VALUE_LENGTH_BYTE_SIZE, "input: Truncated value length");
+
+        if(valueLength > outputHeader.VALUE_MAX_LENGTH)
+            throwTranscodeLengthError("value", offset);
+
+        count += writeSizedData(outputHeader.VALUE_MAX_LENGTH, outputHeader.VALUE_LENGTH_BYTE_SIZE, output, input, valueLength, buffer.get(), bufferSize);
+
+        offset += inputHeader->NAME_LENGTH_BYTE_SIZE + nameLength + inputHeader->VALUE_LENGTH_BYTE_SIZE + valueLength;
+    }
+
+    return count;
+}
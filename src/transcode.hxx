@@ -0,0 +1,44 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_TRANSCODE_HXX_INCLUDED
+#define BDP_TRANSCODE_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+namespace BDP {
+    const size_t DEFAULT_TRANSCODE_BUFFER_SIZE = 65536u;
+
+    size_t getTranscodedLength(const uint8_t* input, size_t inputLength, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize);
+
+    size_t transcodePackage(const uint8_t* input, size_t inputLength, uint8_t* output, size_t outputLength, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize);
+    size_t transcodePackage(std::istream& input, std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize);
+    size_t transcodePackage(std::istream& input, std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, size_t bufferSize);
+}
+
+#endif
@@ -0,0 +1,214 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "view.hxx"
+#include "checksum.hxx"
+
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+BDP::Header readViewHeader(const uint8_t* package, size_t packageLength) {
+    if(packageLength < BDP::HEADER_LENGTH)
+        throw std::invalid_argument("package: Invalid package header");
+
+    // Extended headers (e.g. compressed packages) are accepted; the values are exposed as they are stored.
+    if(packageLength < BDP::EXTENDED_HEADER_LENGTH && memcmp(package, "BDX", 3u) == 0)
+        throw std::invalid_argument("package: Invalid package header");
+
+    BDP::Header header = BDP::decodeExtendedHeader(package);
+
+    // The names of dictionary packages depend on the earlier pairs, so they can't be decoded one by one.
+    if((header.FLAGS & BDP::HEADER_FLAG_NAME_DICTIONARY) != 0u)
+        throw std::invalid_argument("package: Dictionary packages must be read with a NameDictionary");
+
+    return header;
+}
+
+BDP::PackageView::PackageView(const uint8_t* package, size_t packageLength) : package(package),
+                                                                             packageLength(packageLength),
+                                                                             header(readViewHeader(package, packageLength)) { }
+
+uint8_t getViewTrailerLength(const BDP::Header& header) {
+    return (header.FLAGS & BDP::HEADER_FLAG_CHECKSUMMED) != 0u ? static_cast<uint8_t>(BDP::CHECKSUM_LENGTH) : 0u;
+}
+
+BDP::PackageView::Iterator BDP::PackageView::begin() const {
+    return Iterator(package + getHeaderLength(&header), package + packageLength, header.NAME_LENGTH_BYTE_SIZE, header.VALUE_LENGTH_BYTE_SIZE,
+                    getViewTrailerLength(header));
+}
+
+BDP::PackageView::Iterator BDP::PackageView::end() const {
+    return Iterator(package + packageLength, package + packageLength, header.NAME_LENGTH_BYTE_SIZE, header.VALUE_LENGTH_BYTE_SIZE,
+                    getViewTrailerLength(header));
+}
+
+BDP::MappedFile::MappedFile(const char* path) : MappedFile(path, AccessPattern::SEQUENTIAL) { }
+
+#ifdef _WIN32
+BDP::MappedFile::MappedFile(const char* path, AccessPattern access) : data(nullptr), length(0u), file(INVALID_HANDLE_VALUE), mapping(nullptr) {
+    DWORD flags = access == AccessPattern::RANDOM ? FILE_FLAG_RANDOM_ACCESS : FILE_FLAG_SEQUENTIAL_SCAN;
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+
+    if(file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("path: Cannot open file");
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size)) {
+        unmap();
+        throw std::runtime_error("path: Cannot get file size");
+    }
+
+    length = static_cast<size_t>(size.QuadPart);
+
+    if(length == 0u)
+        return;
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if(mapping == nullptr) {
+        unmap();
+        throw std::runtime_error("path: Cannot map file");
+    }
+
+    data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+    if(data == nullptr) {
+        unmap();
+        throw std::runtime_error("path: Cannot map file");
+    }
+}
+
+void BDP::MappedFile::unmap() {
+    if(data != nullptr)
+        UnmapViewOfFile(data);
+    if(mapping != nullptr)
+        CloseHandle(mapping);
+    if(file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+
+    data = nullptr;
+    length = 0u;
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+}
+
+BDP::MappedFile::MappedFile(MappedFile&& other) noexcept : data(other.data), length(other.length), file(other.file), mapping(other.mapping) {
+    other.data = nullptr;
+    other.length = 0u;
+    other.file = INVALID_HANDLE_VALUE;
+    other.mapping = nullptr;
+}
+
+BDP::MappedFile& BDP::MappedFile::operator=(MappedFile&& other) noexcept {
+    if(this != &other) {
+        unmap();
+
+        std::swap(data, other.data);
+        std::swap(length, other.length);
+        std::swap(file, other.file);
+        std::swap(mapping, other.mapping);
+    }
+
+    return *this;
+}
+#else
+BDP::MappedFile::MappedFile(const char* path, AccessPattern access) : data(nullptr), length(0u) {
+    int fd = open(path, O_RDONLY);
+
+    if(fd == -1)
+        throw std::runtime_error("path: Cannot open file");
+
+    struct stat info;
+    if(fstat(fd, &info) == -1) {
+        close(fd);
+        throw std::runtime_error("path: Cannot get file size");
+    }
+
+    length = static_cast<size_t>(info.st_size);
+
+    if(length == 0u) {
+        close(fd);
+        return;
+    }
+
+    void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps its own reference to the file.
+    close(fd);
+
+    if(address == MAP_FAILED) {
+        length = 0u;
+        throw std::runtime_error("path: Cannot map file");
+    }
+
+    // Packages are usually read from start to end, so let the kernel read ahead aggressively. Random access
+    // (e.g. hash probes) would only waste the read-ahead, and lose the pages which are dropped behind it.
+    madvise(address, length, access == AccessPattern::RANDOM ? MADV_RANDOM : MADV_SEQUENTIAL);
+
+    data = static_cast<const uint8_t*>(address);
+}
+
+void BDP::MappedFile::unmap() {
+    if(data != nullptr)
+        munmap(const_cast<uint8_t*>(data), length);
+
+    data = nullptr;
+    length = 0u;
+}
+
+BDP::MappedFile::MappedFile(MappedFile&& other) noexcept : data(other.data), length(other.length) {
+    other.data = nullptr;
+    other.length = 0u;
+}
+
+BDP::MappedFile& BDP::MappedFile::operator=(MappedFile&& other) noexcept {
+    if(this != &other) {
+        unmap();
+
+        std::swap(data, other.data);
+        std::swap(length, other.length);
+    }
+
+    return *this;
+}
+#endif
+
+BDP::MappedFile::~MappedFile() {
+    unmap();
+}
+
+BDP::MappedPackage::MappedPackage(const char* path) : MappedPackage(path, AccessPattern::SEQUENTIAL) { }
+
+BDP::MappedPackage::MappedPackage(const char* path, AccessPattern access) : file(path, access), view(file.getData(), file.getLength()) { }
@@ -0,0 +1,205 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef BDP_VIEW_HXX_INCLUDED
+#define BDP_VIEW_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+namespace BDP {
+    struct PairView {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    class PackageView {
+    public:
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = PairView;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const PairView*;
+            using reference         = const PairView&;
+
+            Iterator(const uint8_t* position, const uint8_t* end, uint8_t nameLengthByteSize, uint8_t valueLengthByteSize);
+            Iterator(const uint8_t* position, const uint8_t* end, uint8_t nameLengthByteSize, uint8_t valueLengthByteSize, uint8_t trailerLength);
+
+            reference operator*() const { return pair; }
+            pointer operator->() const { return &pair; }
+
+            Iterator& operator++();
+            Iterator operator++(int);
+
+            bool operator==(const Iterator& other) const { return position == other.position; }
+            bool operator!=(const Iterator& other) const { return position != other.position; }
+
+            const uint8_t* getPosition() const { return position; }
+
+        private:
+            void decode();
+
+            const uint8_t* position;
+            const uint8_t* next;
+            const uint8_t* end;
+
+            uint8_t nameLengthByteSize;
+            uint8_t valueLengthByteSize;
+            uint8_t trailerLength;
+
+            PairView pair;
+        };
+
+        PackageView(const uint8_t* package, size_t packageLength);
+
+        const Header& getHeader() const { return header; }
+        const uint8_t* getData() const { return package; }
+        size_t getLength() const { return packageLength; }
+
+        Iterator begin() const;
+        Iterator end() const;
+
+    private:
+        const uint8_t* package;
+        size_t packageLength;
+
+        Header header;
+    };
+
+    enum class AccessPattern : uint8_t {
+        SEQUENTIAL,
+        RANDOM
+    };
+
+    class MappedFile {
+    public:
+        explicit MappedFile(const char* path);
+        MappedFile(const char* path, AccessPattern access);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        const uint8_t* getData() const { return data; }
+        size_t getLength() const { return length; }
+
+    private:
+        void unmap();
+
+        const uint8_t* data;
+        size_t length;
+
+#ifdef _WIN32
+        void* file;
+        void* mapping;
+#endif
+    };
+
+    class MappedPackage {
+    public:
+        explicit MappedPackage(const char* path);
+        MappedPackage(const char* path, AccessPattern access);
+
+        const Header& getHeader() const { return view.getHeader(); }
+        const PackageView& getView() const { return view; }
+
+        PackageView::Iterator begin() const { return view.begin(); }
+        PackageView::Iterator end() const { return view.end(); }
+
+    private:
+        MappedFile file;
+        PackageView view;
+    };
+
+    inline PackageView::Iterator::Iterator(const uint8_t* position, const uint8_t* end, uint8_t nameLengthByteSize, uint8_t valueLengthByteSize)
+        : Iterator(position, end, nameLengthByteSize, valueLengthByteSize, 0u) { }
+
+    inline PackageView::Iterator::Iterator(const uint8_t* position, const uint8_t* end, uint8_t nameLengthByteSize, uint8_t valueLengthByteSize, uint8_t trailerLength)
+        : position(position), next(position), end(end), nameLengthByteSize(nameLengthByteSize), valueLengthByteSize(valueLengthByteSize),
+          trailerLength(trailerLength), pair() {
+        decode();
+    }
+
+    inline PackageView::Iterator& PackageView::Iterator::operator++() {
+        position = next;
+        decode();
+
+        return *this;
+    }
+
+    inline PackageView::Iterator PackageView::Iterator::operator++(int) {
+        Iterator copy = *this;
+        ++(*this);
+
+        return copy;
+    }
+
+    // Only the length fields are decoded; the name and value are views into the package.
+    inline void PackageView::Iterator::decode() {
+        if(position == end)
+            return;
+
+        size_t nameLength = 0u;
+        size_t valueLength = 0u;
+        const uint8_t* index = position;
+
+        if(static_cast<size_t>(end - index) < nameLengthByteSize)
+            throw std::runtime_error("package: Truncated name length");
+
+        bytesToLength(nameLength, index, nameLengthByteSize);
+        index += nameLengthByteSize;
+
+        if(static_cast<size_t>(end - index) < nameLength)
+            throw std::runtime_error("package: Truncated name");
+
+        pair.name = std::string_view(reinterpret_cast<const char*>(index), nameLength);
+        index += nameLength;
+
+        if(static_cast<size_t>(end - index) < valueLengthByteSize)
+            throw std::runtime_error("package: Truncated value length");
+
+        bytesToLength(valueLength, index, valueLengthByteSize);
+        index += valueLengthByteSize;
+
+        if(static_cast<size_t>(end - index) < valueLength)
+            throw std::runtime_error("package: Truncated value");
+
+        pair.value = std::string_view(reinterpret_cast<const char*>(index), valueLength);
+        index += valueLength;
+
+        // The trailer (e.g. the checksum of checksummed packages) is skipped, not verified.
+        if(static_cast<size_t>(end - index) < trailerLength)
+            throw std::runtime_error("package: Truncated pair trailer");
+
+        next = index + trailerLength;
+    }
+}
+
+#endif
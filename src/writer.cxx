@@ -0,0 +1,240 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "writer.hxx"
+#include "codec.hxx"
+#include "metrics.hxx"
+
+#include <stdexcept>
+
+BDP::Header createWriterHeader(uint8_t nameLengthBitSize, uint8_t valueLengthBitSize) {
+    uint8_t bytes[BDP::HEADER_LENGTH];
+    BDP::encodeHeader(bytes, nameLengthBitSize, valueLengthBitSize);
+
+    return BDP::decodeHeader(bytes);
+}
+
+BDP::PackageWriter::PackageWriter(std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize)
+    : PackageWriter(output, nameLengthBitSize, valueLengthBitSize, DEFAULT_WRITER_BUFFER_SIZE) { }
+
+BDP::PackageWriter::PackageWriter(std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, size_t bufferSize)
+    : output(output),
+      header(createWriterHeader(nameLengthBitSize, valueLengthBitSize)),
+      encodePair(nullptr),
+      buffer(std::make_unique<uint8_t[]>(bufferSize)),
+      bufferSize(bufferSize),
+      used(0u),
+      bytesWritten(0u),
+      failed(false) {
+    // The buffer must be able to hold the header, and the length fields of a pair.
+    if(bufferSize < 2u * sizeof(uint64_t))
+        throw std::invalid_argument("bufferSize");
+
+    // Pick the specialized encoder once, so buffered pairs don't branch on the package type.
+    encodePair = dispatch(&header, [this](auto codec) -> PairEncoder {
+        used = decltype(codec)::writeHeader(buffer.get());
+        return &decltype(codec)::writePair;
+    });
+
+    bytesWritten = used;
+
+    BDP_COUNT(BUFFER_ALLOCATIONS, 1u);
+}
+
+// A writer which failed doesn't flush, so a partial pair is not completed with garbage.
+BDP::PackageWriter::~PackageWriter() {
+    try {
+        if(!failed)
+            flush();
+    } catch(...) { }
+}
+
+void BDP::PackageWriter::checkFailed() const {
+    if(failed)
+        throw std::runtime_error("output: A write failed, so the package can't be continued");
+}
+
+// The stream state is checked after every write, so a full disk or a closed stream isn't noticed
+// only after more pairs were counted as written.
+void BDP::PackageWriter::writeOutput(const uint8_t* data, size_t dataLength) {
+    output.write(reinterpret_cast<const char*>(data), dataLength);
+
+    if(!output) {
+        failed = true;
+        throw std::runtime_error("output: Cannot write to the stream");
+    }
+}
+
+size_t BDP::PackageWriter::writePair(const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength) {
+    checkFailed();
+
+    if(nameLength > header.NAME_MAX_LENGTH)
+        throw std::invalid_argument("nameLength");
+    if(valueLength > header.VALUE_MAX_LENGTH)
+        throw std::invalid_argument("valueLength");
+
+    size_t pairLength = header.NAME_LENGTH_BYTE_SIZE + nameLength + header.VALUE_LENGTH_BYTE_SIZE + valueLength;
+
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+    BDP_COUNT(BYTES_WRITTEN, pairLength);
+
+    if(pairLength <= bufferSize - used) {
+        used += encodePair(buffer.get() + used, name, nameLength, value, valueLength);
+        bytesWritten += pairLength;
+
+        return pairLength;
+    }
+
+    if(pairLength <= bufferSize) {
+        flushBuffer();
+
+        used = encodePair(buffer.get(), name, nameLength, value, valueLength);
+        bytesWritten += pairLength;
+
+        return pairLength;
+    }
+
+    // The pair is larger than the buffer. Buffer the small parts, and write the large
+    // parts directly, so they are never copied.
+    appendLength(nameLength, header.NAME_LENGTH_BYTE_SIZE);
+    append(name, nameLength);
+    appendLength(valueLength, header.VALUE_LENGTH_BYTE_SIZE);
+    append(value, valueLength);
+
+    return pairLength;
+}
+
+size_t BDP::PackageWriter::writePair(const uint8_t* name, size_t nameLength, std::istream& value, size_t valueLength) {
+    checkFailed();
+
+    if(nameLength > header.NAME_MAX_LENGTH)
+        throw std::invalid_argument("nameLength");
+    if(valueLength > header.VALUE_MAX_LENGTH)
+        throw std::invalid_argument("valueLength");
+
+    size_t bytesWrittenBefore = bytesWritten;
+
+    // The value is read after the name is buffered, so a failed read must not leave half a pair
+    // in the buffer. The pair is always the tail of the buffer; if part of it was already flushed,
+    // the package can't be repaired.
+    try {
+        appendLength(nameLength, header.NAME_LENGTH_BYTE_SIZE);
+        append(name, nameLength);
+        appendLength(valueLength, header.VALUE_LENGTH_BYTE_SIZE);
+        appendValue(value, valueLength);
+    } catch(...) {
+        size_t pairBytes = bytesWritten - bytesWrittenBefore;
+
+        if(pairBytes <= used) {
+            used -= pairBytes;
+            bytesWritten = bytesWrittenBefore;
+        } else {
+            failed = true;
+        }
+
+        throw;
+    }
+
+    size_t pairLength = header.NAME_LENGTH_BYTE_SIZE + nameLength + header.VALUE_LENGTH_BYTE_SIZE + valueLength;
+
+    BDP_COUNT(PAIRS_WRITTEN, 1u);
+    BDP_COUNT(BYTES_WRITTEN, pairLength);
+
+    return pairLength;
+}
+
+void BDP::PackageWriter::flush() {
+    flushBuffer();
+    output.flush();
+
+    if(!output) {
+        failed = true;
+        throw std::runtime_error("output: Cannot write to the stream");
+    }
+}
+
+void BDP::PackageWriter::flushBuffer() {
+    checkFailed();
+
+    if(used == 0u)
+        return;
+
+    BDP_TIME(WRITER_FLUSH);
+    BDP_COUNT(STREAM_WRITES, 1u);
+
+    size_t length = used;
+    used = 0u;
+
+    writeOutput(buffer.get(), length);
+}
+
+// The value length is known, so the value is read straight into the buffer and the output never seeks.
+void BDP::PackageWriter::appendValue(std::istream& value, size_t valueLength) {
+    size_t remaining = valueLength;
+    size_t nextLength;
+    size_t count;
+
+    while(remaining > 0u) {
+        if(used == bufferSize)
+            flushBuffer();
+
+        nextLength = remaining < bufferSize - used ? remaining : bufferSize - used;
+        value.read(reinterpret_cast<char*>(buffer.get() + used), nextLength);
+
+        count = static_cast<size_t>(value.gcount());
+
+        BDP_COUNT(STREAM_READS, 1u);
+
+        // A stream which failed without reaching its end reads nothing, and never sets eofbit.
+        if(count == 0u)
+            throw std::runtime_error("value: The stream ended before the specified length was reached");
+
+        used += count;
+        bytesWritten += count;
+        remaining -= count;
+    }
+}
+
+void BDP::PackageWriter::append(const uint8_t* data, size_t dataLength) {
+    if(dataLength <= bufferSize - used) {
+        memcpy(buffer.get() + used, data, dataLength);
+        used += dataLength;
+    } else {
+        flushBuffer();
+        writeOutput(data, dataLength);
+
+        BDP_COUNT(STREAM_WRITES, 1u);
+    }
+
+    bytesWritten += dataLength;
+}
+
+void BDP::PackageWriter::appendLength(size_t length, uint8_t lengthByteSize) {
+    if(lengthByteSize > bufferSize - used)
+        flushBuffer();
+
+    lengthToBytes(buffer.get() + used, length, lengthByteSize);
+
+    used += lengthByteSize;
+    bytesWritten += lengthByteSize;
+}
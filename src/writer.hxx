@@ -0,0 +1,78 @@
+/**
+ * BDP (https://github.com/UnexomWid/BDP)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019-2020 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef BDP_WRITER_HXX_INCLUDED
+#define BDP_WRITER_HXX_INCLUDED
+
+#include "bdp.hxx"
+
+#include <istream>
+#include <memory>
+#include <ostream>
+
+namespace BDP {
+    /// The default size of the PackageWriter buffer.
+    const size_t DEFAULT_WRITER_BUFFER_SIZE = 65536u;
+
+    class PackageWriter {
+    public:
+        PackageWriter(std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize);
+        PackageWriter(std::ostream& output, uint8_t nameLengthBitSize, uint8_t valueLengthBitSize, size_t bufferSize);
+        ~PackageWriter();
+
+        PackageWriter(const PackageWriter&) = delete;
+        PackageWriter& operator=(const PackageWriter&) = delete;
+
+        size_t writePair(const uint8_t* name, size_t nameLength, const uint8_t* value, size_t valueLength);
+        size_t writePair(const uint8_t* name, size_t nameLength, std::istream& value, size_t valueLength);
+
+        void flush();
+
+        const Header& getHeader() const { return header; }
+        size_t getBytesWritten() const { return bytesWritten; }
+        size_t getBytesFlushed() const { return bytesWritten - used; }
+
+    private:
+        using PairEncoder = size_t (*)(uint8_t*, const uint8_t*, size_t, const uint8_t*, size_t);
+
+        void append(const uint8_t* data, size_t dataLength);
+        void appendLength(size_t length, uint8_t lengthByteSize);
+        void appendValue(std::istream& value, size_t valueLength);
+        void checkFailed() const;
+        void flushBuffer();
+        void writeOutput(const uint8_t* data, size_t dataLength);
+
+        std::ostream& output;
+        Header header;
+        PairEncoder encodePair;
+
+        std::unique_ptr<uint8_t[]> buffer;
+        size_t bufferSize;
+        size_t used;
+
+        size_t bytesWritten;
+        bool failed;
+    };
+}
+
+#endif